@@ -0,0 +1,98 @@
+#include "rlog.hpp"
+
+#include <chrono>
+#include <iostream>
+
+// -------------------------------------------------------------------
+// measures throughput of SmartFormatter with defaultSmartFormat, parsed
+// at run time and at compile time, by R_SMART_FORMAT, against formatting
+// by find & replace passes over a copy of the format, as SmartFormatter
+// did before parsing it once
+// build in release mode
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+
+// -------------------------------------------------------------------
+
+static constexpr long iterations = 2000000;
+
+// -------------------------------------------------------------------
+
+void replace(string& in, const string& pattern, const string& with) {
+    const size_t pos = in.find(pattern);
+    if (pos != string::npos) {
+        in.replace(pos, pattern.length(), with);
+    }
+}
+
+/**
+ * @brief Formats like SmartFormatter did before, for reference
+ */
+string reference(const string& format,
+                 const R::Metadata& metadata,
+                 const string& message) {
+    string result = format;
+    if (result.find("#timestamp") != string::npos) {
+        replace(result, "#timestamp", metadata.timestamp());
+    }
+    replace(result, "#level", R::to_string(metadata.level));
+    replace(result, "#tag", metadata.tag.empty() ? "" : "#" + metadata.tag);
+    replace(result, "#filename", metadata.filename);
+    replace(result, "#line", to_string(metadata.line));
+    replace(result, "#message", message);
+    return result;
+}
+
+/**
+ * @brief Returns nanoseconds per message formatted by given formatter,
+ *          and adds up their sizes
+ */
+template <typename Formatter>
+double nanosPerFormat(Formatter formatter, size_t& bytes) {
+    R::Metadata metadata(R::Level::Warning, __FILE__, __LINE__);
+    metadata.tag = "bench";
+    const string message = "a message of some length, with a value 42";
+    const auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        bytes += formatter(metadata, message).size();
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() / iterations;
+}
+
+void report(const char* name, double nanos, size_t bytes) {
+    cout << name << ": " << nanos << " ns/log, " << 1000 / nanos
+         << " M logs/s, " << bytes / iterations << " bytes/log" << endl;
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main() {
+    size_t bytes = 0;
+    const R::internal::SmartFormat parsed(R::defaultSmartFormat);
+    double nanos = nanosPerFormat(parsed, bytes);
+    report("SmartFormatter", nanos, bytes);
+
+    bytes = 0;
+    nanos = nanosPerFormat(R_SMART_FORMAT(R::defaultSmartFormat), bytes);
+    report("R_SMART_FORMAT", nanos, bytes);
+
+    bytes = 0;
+    const string format = R::defaultSmartFormat;
+    const auto replacing = R_FORMATTER_W_CAPTURE(metadata, message, &) {
+        return reference(format, metadata, message);
+    };
+    nanos = nanosPerFormat(replacing, bytes);
+    report("find & replace", nanos, bytes);
+    return 0;
+}
+
+// -------------------------------------------------------------------
@@ -0,0 +1,127 @@
+#include "rlog.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// -------------------------------------------------------------------
+// measures json escaping, as JsonFormatter does for tag, filename and
+// message, over mixes of messages, by R_INTERNAL_SIMD wide scans against
+// escaping a character at a time
+// build in release mode, with -mavx2 for 32 byte scans
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+
+// -------------------------------------------------------------------
+
+static constexpr long iterations = 200000;
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Escapes a character at a time, as rlog did before
+ */
+void reference(string& out, const string& value) {
+    static constexpr char hex[] = "0123456789abcdef";
+    for (const char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xf];
+                    out += hex[c & 0xf];
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+/**
+ * @brief Returns MB/s escaping given messages, in turn
+ */
+template <typename Escape>
+double megabytesPerSecond(const vector<string>& messages, Escape escape) {
+    size_t bytes = 0;
+    size_t escaped = 0;
+    string out;
+    const auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        const string& message = messages[i % messages.size()];
+        out.clear();
+        escape(out, message);
+        bytes += message.size();
+        escaped += out.size();
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    // keeps the work from being optimized away
+    if (escaped < bytes) {
+        cout << "wrong size" << endl;
+    }
+    return bytes / chrono::duration<double, micro>(elapsed).count();
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main() {
+    const string query =
+        "SELECT id, name, email FROM users WHERE created_at > '2020-01-01' "
+        "AND status = 'active' ORDER BY created_at DESC LIMIT 100 OFFSET 200";
+    struct Mix {
+        const char* name;
+        vector<string> messages;
+    };
+    const Mix mixes[] = {
+        {"short",
+         {"user 42 logged in", "cache miss", "request took 12ms",
+          "connected to 10.0.0.1:8080"}},
+        {"long", {query, query + " -- retried", query + " -- slow"}},
+        {"quoted json",
+         {"payload {\"id\": 42, \"name\": \"foo\", \"tags\": [\"a\", \"b\"]}",
+          "got \"ok\" from server"}},
+        {"multi-line",
+         {"exception: out of range\n  at parse (parser.cpp:120)\n  at load "
+          "(loader.cpp:44)\n  at main (main.cpp:12)\n",
+          "line one\r\nline two\ttabbed\r\n"}},
+        {"utf-8",
+         {"h\xc3\xa9llo w\xc3\xb6rld, caf\xc3\xa9 \xe2\x9c\x93",
+          "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\xad\xe3"
+          "\x82\xb0 message"}},
+    };
+    cout << "R_INTERNAL_SIMD " << R_INTERNAL_SIMD << endl;
+    for (const auto& mix : mixes) {
+        const double fast = megabytesPerSecond(
+            mix.messages, [](string& out, const string& message) {
+                R::internal::json_escape(out, message);
+            });
+        const double slow = megabytesPerSecond(mix.messages, reference);
+        cout << mix.name << ": " << fast << " MB/s, a character at a time: "
+             << slow << " MB/s" << endl;
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
@@ -0,0 +1,88 @@
+#include "rlog.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+// -------------------------------------------------------------------
+// measures what a log filtered out by run-time levels costs
+// build in release mode; disassembling filtered() should show a single
+// load and compare before returning
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+
+// -------------------------------------------------------------------
+
+static constexpr long iterations = 100000000;
+
+// -------------------------------------------------------------------
+
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void filtered(long i) { R_INFO("bench") << "value " << i; }
+
+BENCH_NOINLINE void filteredByTag(long i) {
+    R_INFO("quiet") << "value " << i;
+}
+
+const std::string quiet = "quiet";
+
+BENCH_NOINLINE void filteredByDynamicTag(long i) {
+    R_INFO(quiet) << "value " << i;
+}
+
+std::atomic<int> baselineLevel(R::Level::Warning);
+
+BENCH_NOINLINE void baseline(long i) {
+    if (R::Level::Info < baselineLevel.load(std::memory_order_relaxed)) {
+        return;
+    }
+    cout << "value " << i;
+}
+
+// -------------------------------------------------------------------
+
+template <typename F>
+double nanosPerCall(F f) {
+    const auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() / iterations;
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main() {
+    R::reset(R::Level::Warning);
+    cout << "filtered-out R_INFO: " << nanosPerCall(filtered) << " ns/log"
+         << endl;
+    cout << "bare atomic load and compare: " << nanosPerCall(baseline)
+         << " ns/log" << endl;
+    // passes the global level, but is filtered by its site's cached level
+    R::reset(R::Level::Info);
+    R::setLevel("quiet", R::Level::Warning);
+    cout << "R_INFO filtered out by tag level: "
+         << nanosPerCall(filteredByTag) << " ns/log" << endl;
+    cout << "R_INFO filtered out by level of an std::string tag: "
+         << nanosPerCall(filteredByDynamicTag) << " ns/log" << endl;
+    R::reset();
+    return 0;
+}
+
+// -------------------------------------------------------------------
@@ -0,0 +1,98 @@
+#include "rlog.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -------------------------------------------------------------------
+// measures what each lock R_LOCK can select costs, uncontended and
+// contended, and what a log to a Serialized Sink costs with the lock
+// this build selected
+// build in release mode
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+
+// -------------------------------------------------------------------
+
+static constexpr long iterations = 2000000;
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Returns nanoseconds per lock & unlock, over all threads
+ */
+template <typename Lock>
+double nanosPerLock(int threads) {
+    Lock lock;
+    long counter = 0;
+    const long perThread = iterations / threads;
+    const auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (long i = 0; i < perThread; ++i) {
+                lock_guard<Lock> guard(lock);
+                ++counter;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() /
+           (perThread * threads);
+}
+
+template <typename Lock>
+void report(const char* name) {
+    cout << name << ": " << nanosPerLock<Lock>(1) << " ns uncontended, "
+         << nanosPerLock<Lock>(4) << " ns with 4 threads" << endl;
+}
+
+/**
+ * @brief Reports a lock that only a single thread may take, uncontended
+ */
+template <typename Lock>
+void reportUncontended(const char* name) {
+    cout << name << ": " << nanosPerLock<Lock>(1) << " ns uncontended"
+         << endl;
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main() {
+    report<std::recursive_mutex>("std::recursive_mutex");
+    report<std::mutex>("std::mutex");
+    report<R::internal::SpinLock>("spin lock");
+    // does not lock at all, so it is never shared between threads
+    reportUncontended<R::internal::NullLock>("no lock (R_SINGLE_THREADED)");
+
+    long count = 0;
+    R::reset(R::Level::Info);
+    R::addSink(R_SINK_W_CAPTURE(metadata, message, &) { ++count; });
+    const auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        R_INFO("bench") << "value " << i;
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    R::reset();
+    cout << "R_INFO to a Serialized Sink, R_LOCK " << R_LOCK
+         << (R_SINGLE_THREADED ? ", R_SINGLE_THREADED: " : ": ")
+         << chrono::duration<double, nano>(elapsed).count() / count
+         << " ns/log" << endl;
+    return 0;
+}
+
+// -------------------------------------------------------------------
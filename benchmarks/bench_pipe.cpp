@@ -0,0 +1,91 @@
+#include "rlog.hpp"
+
+#include <chrono>
+#include <iostream>
+
+// -------------------------------------------------------------------
+// measures a filtered, formatted sink composed of std::functions, by
+// makeFilteredSink & makeFormattedSink, against the same one composed
+// by R::pipe, called directly, and through a Logger of two of them
+// build in release mode
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+
+// -------------------------------------------------------------------
+
+static constexpr long iterations = 5000000;
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Stands in for a file, counting bytes it is given
+ */
+struct ByteSink {
+    R_SINK_OPERATOR(metadata, message) { bytes += message.size(); }
+    size_t bytes = 0;
+};
+
+const auto warnings = R_FILTER(metadata, message) {
+    return metadata.level >= R::Level::Warning;
+};
+
+const auto tagged = R_FORMATTER(metadata, message) {
+    return metadata.tag + message;
+};
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Returns nanoseconds per call of given sink, half filtered out
+ */
+template <typename Sink>
+double nanosPerCall(Sink& sink) {
+    R::Metadata warning(R::Level::Warning, __FILE__, __LINE__);
+    R::Metadata info(R::Level::Info, __FILE__, __LINE__);
+    warning.tag = info.tag = "bench ";
+    const string message = "a message of some length";
+    const auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        sink(i % 2 ? warning : info, message);
+    }
+    const auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() / iterations;
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main() {
+    ByteSink bytes;
+    R::Sink nested = R::makeFilteredSink(
+        R::makeFormattedSink(ref(bytes), tagged), warnings);
+    cout << "makeFilteredSink & makeFormattedSink: " << nanosPerCall(nested)
+         << " ns/call" << endl;
+
+    auto piped = R::pipe(warnings, tagged, ref(bytes));
+    cout << "R::pipe: " << nanosPerCall(piped) << " ns/call" << endl;
+
+    R::Sink nestedTwice = R_SINK_W_CAPTURE(metadata, message, &) {
+        nested(metadata, message);
+        nested(metadata, message);
+    };
+    cout << "two nested in a Sink: " << nanosPerCall(nestedTwice)
+         << " ns/call" << endl;
+
+    auto logger = R::makeLogger(piped, piped);
+    R::Sink pipedTwice = ref(logger);
+    cout << "two pipes in a Logger, as a Sink: " << nanosPerCall(pipedTwice)
+         << " ns/call" << endl;
+
+    // keeps the work from being optimized away
+    return bytes.bytes == 0;
+}
+
+// -------------------------------------------------------------------
@@ -0,0 +1,130 @@
+#include "rlog.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// -------------------------------------------------------------------
+// measures how logging scales with threads, to a file-like sink that
+// needs serializing and a metrics counter that does not, by SinkPolicy
+// build in release mode
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+
+// -------------------------------------------------------------------
+
+static constexpr long logsPerThread = 200000;
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Stands in for a file, appending every message to a buffer
+ *        Not thread safe
+ */
+struct FileSink {
+    R_SINK_OPERATOR(metadata, message) {
+        buffer.append(message);
+        buffer += '\n';
+        if (buffer.size() > (1 << 20)) {
+            bytes += buffer.size();
+            buffer.clear();
+        }
+    }
+    string buffer;
+    size_t bytes = 0;
+};
+
+/**
+ * @brief Stands in for a metrics counter, thread safe by itself
+ */
+struct CounterSink {
+    R_SINK_OPERATOR(metadata, message) {
+        count.fetch_add(1, memory_order_relaxed);
+    }
+    atomic<long> count{0};
+};
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Returns nanoseconds per log, over all threads
+ */
+double nanosPerLog(int threads) {
+    const auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([] {
+            for (long i = 0; i < logsPerThread; ++i) {
+                R_INFO("bench") << "value " << i;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    R::flush();
+    const auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() /
+           (threads * logsPerThread);
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main() {
+    const int threadCounts[] = {1, 2, 4, 8};
+    struct Setup {
+        const char* name;
+        R::SinkPolicy file;
+        R::SinkPolicy counter;
+    };
+    const Setup setups[] = {
+        {"both serialized", R::SinkPolicy::Serialized,
+         R::SinkPolicy::Serialized},
+        {"counter thread safe", R::SinkPolicy::Serialized,
+         R::SinkPolicy::ThreadSafe},
+        {"file confined, counter thread safe", R::SinkPolicy::Confined,
+         R::SinkPolicy::ThreadSafe},
+    };
+    for (const auto& setup : setups) {
+        cout << setup.name << endl;
+        for (const int threads : threadCounts) {
+            FileSink file;
+            CounterSink counter;
+            R::reset(R::Level::Info);
+            R::addSink(ref(file), setup.file);
+            R::addSink(ref(counter), setup.counter);
+            const double nanos = nanosPerLog(threads);
+            R::reset();
+            cout << "  " << threads << " threads: " << nanos << " ns/log, "
+                 << 1000 / nanos << " M logs/s" << endl;
+        }
+    }
+    // one sink doing both, as when all sinks shared one lock
+    cout << "single lock for both" << endl;
+    for (const int threads : threadCounts) {
+        FileSink file;
+        CounterSink counter;
+        R::reset(R::Level::Info);
+        R::addSink(R_SINK_W_CAPTURE(metadata, message, &) {
+            file(metadata, message);
+            counter(metadata, message);
+        });
+        const double nanos = nanosPerLog(threads);
+        R::reset();
+        cout << "  " << threads << " threads: " << nanos << " ns/log, "
+             << 1000 / nanos << " M logs/s" << endl;
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------
@@ -20,16 +20,55 @@
 /// external headers
 
 #include <time.h>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#define R_INTERNAL_X86 (true)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#else
+#define R_INTERNAL_X86 (false)
+#endif
+
+// widest vectors the target has, in bytes
+#if R_INTERNAL_X86 && defined(__AVX2__)
+#define R_INTERNAL_SIMD (32)
+#elif R_INTERNAL_X86 &&                                \
+    (defined(__SSE2__) || defined(_M_X64) ||           \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define R_INTERNAL_SIMD (16)
+#else
+#define R_INTERNAL_SIMD (0)
+#endif
+
 // -----------------------------------------------------------
 /// private macros
 /// all macros starting with _ are for internal use only
@@ -38,11 +77,84 @@
     _name(const _name&) = delete;              \
     _name& operator=(const _name&) = delete;
 
-#define R_INTERNAL_LOG(_level, _tag)                                      \
-    if (R_MIN_LEVEL > R::Level::_level) {                                 \
-    } else if (R::Level::_level < R::internal::Store::instance().level) { \
-    } else                                                                \
-        R::internal::Log(R::Level::_level, __FILE__, __LINE__, _tag).stream()
+#ifdef __FILE_NAME__
+#define R_INTERNAL_FILENAME \
+    (R::StringRef(__FILE_NAME__, sizeof(__FILE_NAME__) - 1))
+#else
+#define R_INTERNAL_FILENAME \
+    (R::internal::basename(__FILE__, sizeof(__FILE__) - 1))
+#endif
+
+#define R_INTERNAL_SITE(_level)                               \
+    []() -> const R::internal::Site& {                        \
+        static R::internal::Site site(                        \
+            R::Level::_level, R_INTERNAL_FILENAME, __LINE__); \
+        return site;                                          \
+    }()
+
+#define R_INTERNAL_LOG(_level, _tag)                                       \
+    if (R_MIN_LEVEL > R::Level::_level) {                                  \
+    } else if (R::Level::_level < R::internal::LevelCache<>::threshold()) { \
+    } else if (const R::internal::Check _r_check{R_INTERNAL_SITE(_level),  \
+                                                 _tag}) {                  \
+    } else                                                                 \
+        R::internal::Log(_r_check).stream()
+
+#define R_INTERNAL_LOG_IF(_level, _tag, _pass)                             \
+    if (R_MIN_LEVEL > R::Level::_level) {                                  \
+    } else if (R::Level::_level < R::internal::LevelCache<>::threshold()) { \
+    } else if (const R::internal::Check _r_check{R_INTERNAL_SITE(_level),  \
+                                                 _tag}) {                  \
+    } else if (!(_pass)) {                                                 \
+    } else                                                                 \
+        R::internal::Log(_r_check).stream()
+
+#define R_INTERNAL_LOG_EVERY_N(_level, _tag, _n) \
+    R_INTERNAL_LOG_IF(_level, _tag, _r_check.site.limiter.everyN(_n))
+
+#define R_INTERNAL_LOG_EVERY_MS(_level, _tag, _ms) \
+    R_INTERNAL_LOG_IF(_level, _tag, _r_check.site.limiter.everyMs(_ms))
+
+#define R_INTERNAL_LOG_FIRST_N(_level, _tag, _n) \
+    R_INTERNAL_LOG_IF(_level, _tag, _r_check.site.limiter.firstN(_n))
+
+#define R_INTERNAL_LOG_SAMPLED(_level, _tag, _rate) \
+    R_INTERNAL_LOG_IF(_level, _tag, R::internal::Sampler::keep(_rate))
+
+#define R_INTERNAL_LOG_SAMPLED_BY(_level, _tag, _rate, _key) \
+    R_INTERNAL_LOG_IF(_level, _tag, R::internal::Sampler::keep(_rate, _key))
+
+#define R_INTERNAL_CHARS_16(_text, _i)                                      \
+    R::internal::charAt(_text, _i + 0), R::internal::charAt(_text, _i + 1), \
+        R::internal::charAt(_text, _i + 2),                                 \
+        R::internal::charAt(_text, _i + 3),                                 \
+        R::internal::charAt(_text, _i + 4),                                 \
+        R::internal::charAt(_text, _i + 5),                                 \
+        R::internal::charAt(_text, _i + 6),                                 \
+        R::internal::charAt(_text, _i + 7),                                 \
+        R::internal::charAt(_text, _i + 8),                                 \
+        R::internal::charAt(_text, _i + 9),                                 \
+        R::internal::charAt(_text, _i + 10),                                \
+        R::internal::charAt(_text, _i + 11),                                \
+        R::internal::charAt(_text, _i + 12),                                \
+        R::internal::charAt(_text, _i + 13),                                \
+        R::internal::charAt(_text, _i + 14),                                \
+        R::internal::charAt(_text, _i + 15)
+
+#define R_INTERNAL_CHARS_256(_text)                                     \
+    R_INTERNAL_CHARS_16(_text, 0), R_INTERNAL_CHARS_16(_text, 16),      \
+        R_INTERNAL_CHARS_16(_text, 32), R_INTERNAL_CHARS_16(_text, 48), \
+        R_INTERNAL_CHARS_16(_text, 64), R_INTERNAL_CHARS_16(_text, 80), \
+        R_INTERNAL_CHARS_16(_text, 96),                                 \
+        R_INTERNAL_CHARS_16(_text, 112),                                \
+        R_INTERNAL_CHARS_16(_text, 128),                                \
+        R_INTERNAL_CHARS_16(_text, 144),                                \
+        R_INTERNAL_CHARS_16(_text, 160),                                \
+        R_INTERNAL_CHARS_16(_text, 176),                                \
+        R_INTERNAL_CHARS_16(_text, 192),                                \
+        R_INTERNAL_CHARS_16(_text, 208),                                \
+        R_INTERNAL_CHARS_16(_text, 224),                                \
+        R_INTERNAL_CHARS_16(_text, 240)
 
 // -----------------------------------------------------------
 /// public macros
@@ -68,6 +180,148 @@
  */
 #define R_ERROR(_tag) R_INTERNAL_LOG(Error, _tag)
 
+/**
+ * @brief Makes a log with level Info, only if a condition holds
+ *        The condition is evaluated after the level checks, and no
+ *          log is constructed when it is false
+ * @param condition: bool
+ * @param tag: const std::string&
+ * @usage R_INFO_IF(retries > 3, "foo") << "bar";
+ */
+#define R_INFO_IF(_condition, _tag) R_INTERNAL_LOG_IF(Info, _tag, _condition)
+
+/**
+ * @brief Makes a log with level Warning, only if a condition holds
+ * @see R_INFO_IF
+ */
+#define R_WARNING_IF(_condition, _tag) \
+    R_INTERNAL_LOG_IF(Warning, _tag, _condition)
+
+/**
+ * @brief Makes a log with level Error, only if a condition holds
+ * @see R_INFO_IF
+ */
+#define R_ERROR_IF(_condition, _tag) R_INTERNAL_LOG_IF(Error, _tag, _condition)
+
+/**
+ * @brief Makes a log with level Info, for only one in n calls
+ *        The first call logs, and the streamed expression is not
+ *          evaluated for suppressed ones
+ *        Number of suppressed calls is on the next log's Metadata
+ * @param tag: const std::string&
+ * @param n: unsigned long long
+ * @usage R_INFO_EVERY_N("foo", 100) << "bar";
+ */
+#define R_INFO_EVERY_N(_tag, _n) R_INTERNAL_LOG_EVERY_N(Info, _tag, _n)
+
+/**
+ * @brief Makes a log with level Warning, for only one in n calls
+ * @see R_INFO_EVERY_N
+ */
+#define R_WARNING_EVERY_N(_tag, _n) R_INTERNAL_LOG_EVERY_N(Warning, _tag, _n)
+
+/**
+ * @brief Makes a log with level Error, for only one in n calls
+ * @see R_INFO_EVERY_N
+ */
+#define R_ERROR_EVERY_N(_tag, _n) R_INTERNAL_LOG_EVERY_N(Error, _tag, _n)
+
+/**
+ * @brief Makes a log with level Info, at most once per period
+ *        The first call logs, and the streamed expression is not
+ *          evaluated for suppressed ones
+ *        Number of suppressed calls is on the next log's Metadata
+ * @param tag: const std::string&
+ * @param ms: long long, period in milliseconds
+ * @usage R_INFO_EVERY_MS("foo", 1000) << "bar";
+ */
+#define R_INFO_EVERY_MS(_tag, _ms) R_INTERNAL_LOG_EVERY_MS(Info, _tag, _ms)
+
+/**
+ * @brief Makes a log with level Warning, at most once per period
+ * @see R_INFO_EVERY_MS
+ */
+#define R_WARNING_EVERY_MS(_tag, _ms) \
+    R_INTERNAL_LOG_EVERY_MS(Warning, _tag, _ms)
+
+/**
+ * @brief Makes a log with level Error, at most once per period
+ * @see R_INFO_EVERY_MS
+ */
+#define R_ERROR_EVERY_MS(_tag, _ms) R_INTERNAL_LOG_EVERY_MS(Error, _tag, _ms)
+
+/**
+ * @brief Makes a log with level Info, for only the first n calls
+ *        The streamed expression is not evaluated for later ones
+ * @param tag: const std::string&
+ * @param n: unsigned long long
+ * @usage R_INFO_FIRST_N("foo", 10) << "bar";
+ */
+#define R_INFO_FIRST_N(_tag, _n) R_INTERNAL_LOG_FIRST_N(Info, _tag, _n)
+
+/**
+ * @brief Makes a log with level Warning, for only the first n calls
+ * @see R_INFO_FIRST_N
+ */
+#define R_WARNING_FIRST_N(_tag, _n) R_INTERNAL_LOG_FIRST_N(Warning, _tag, _n)
+
+/**
+ * @brief Makes a log with level Error, for only the first n calls
+ * @see R_INFO_FIRST_N
+ */
+#define R_ERROR_FIRST_N(_tag, _n) R_INTERNAL_LOG_FIRST_N(Error, _tag, _n)
+
+/**
+ * @brief Makes a log with level Info, for a random fraction of calls
+ *        Decided by a thread-local generator, so that threads share no
+ *          state, and the streamed expression is not evaluated for
+ *          dropped calls
+ * @param tag: const std::string&
+ * @param rate: double, fraction of calls to keep, in [0, 1]
+ * @usage R_INFO_SAMPLED("foo", 0.01) << "bar";
+ */
+#define R_INFO_SAMPLED(_tag, _rate) R_INTERNAL_LOG_SAMPLED(Info, _tag, _rate)
+
+/**
+ * @brief Makes a log with level Warning, for a random fraction of calls
+ * @see R_INFO_SAMPLED
+ */
+#define R_WARNING_SAMPLED(_tag, _rate) \
+    R_INTERNAL_LOG_SAMPLED(Warning, _tag, _rate)
+
+/**
+ * @brief Makes a log with level Error, for a random fraction of calls
+ * @see R_INFO_SAMPLED
+ */
+#define R_ERROR_SAMPLED(_tag, _rate) \
+    R_INTERNAL_LOG_SAMPLED(Error, _tag, _rate)
+
+/**
+ * @brief Makes a log with level Info, for a fraction of keys
+ *        Decided by a hash of the key, so that all logs of a kept key
+ *          are kept, on any thread or process
+ * @param tag: const std::string&
+ * @param rate: double, fraction of keys to keep, in [0, 1]
+ * @param key: integer or string, e.g. a request id
+ * @usage R_INFO_SAMPLED_BY("foo", 0.01, request.id) << "bar";
+ */
+#define R_INFO_SAMPLED_BY(_tag, _rate, _key) \
+    R_INTERNAL_LOG_SAMPLED_BY(Info, _tag, _rate, _key)
+
+/**
+ * @brief Makes a log with level Warning, for a fraction of keys
+ * @see R_INFO_SAMPLED_BY
+ */
+#define R_WARNING_SAMPLED_BY(_tag, _rate, _key) \
+    R_INTERNAL_LOG_SAMPLED_BY(Warning, _tag, _rate, _key)
+
+/**
+ * @brief Makes a log with level Error, for a fraction of keys
+ * @see R_INFO_SAMPLED_BY
+ */
+#define R_ERROR_SAMPLED_BY(_tag, _rate, _key) \
+    R_INTERNAL_LOG_SAMPLED_BY(Error, _tag, _rate, _key)
+
 /**
  * @brief Defines a sink without captures
  * @param identifier for metadata : const R::Metadata&
@@ -142,6 +396,21 @@
     [_capture](const R::Metadata& _metadata,              \
                const std::string& _message) -> bool
 
+/**
+ * @brief Makes a SmartFormatter for a format known at compile time
+ *        The format is parsed by the compiler, into the type of the
+ *          formatter, so a log only sizes its fields, allocates once
+ *          and copies them
+ * @param format: string literal, or constexpr const char*, shorter than
+ *          256 characters
+ * @return formatter of its own type, i.e. a Formatter compatible callable
+ * @usage R::pipe(R_SMART_FORMAT("#level #message"), R::CoutSink);
+ */
+#define R_SMART_FORMAT(_format)                                        \
+    (R::internal::StaticFormatOf<(R::internal::charAt(_format, 255) == \
+                                  '\0'),                               \
+                                 R_INTERNAL_CHARS_256(_format)>::type())
+
 /**
  * @brief Declare the << operator for specified type as friend
  * @param type's name
@@ -175,193 +444,133 @@
 #endif
 
 // -----------------------------------------------------------
-
-namespace R {
-
-// -----------------------------------------------------------
+/// stream insertion, kept out of namespace R
 
 /**
- * @brief Severity levels
+ * @brief std::ostream of type Base, declared in the global namespace
+ *        Inserting into it also finds, by argument-dependent lookup, the
+ *          << operators declared at global scope for types of other
+ *          namespaces, e.g. with R_USERTYPE_DEF, even after this file
  */
-enum Level { Info, Warning, Error, Off };
+template <typename Base>
+struct rlog_ostream : Base {
+    using Base::Base;
+};  // rlog_ostream
 
-// -----------------------------------------------------------
+namespace rlog_detail {
 
 /**
- * @brief Holds metadata of a log, i.e.
- *          level, filename, line, timestamp & tag
- *        Gets passed to the filters, formatters & sinks
+ * @brief Inserts value into os, using its std::ostream << operator
+ *        Outside namespace R, whose own << operators would hide the ones
+ *          declared at global scope
+ * @param os: rlog_ostream<Base>&
+ * @param value: const T&
  */
-struct Metadata {
-    Metadata(Level level,
-             const std::string& filename,
-             long line,
-             const std::string& tag = "")
-        : level(level),
-          filename([&] {
-              // separate filename from full path
-              return filename.substr(filename.find_last_of("/\\") + 1);
-          }()),
-          line(line),
-          timestamp([] {
-              // capture current time
-              auto now = std::chrono::system_clock::now();
-              auto time_tt = std::chrono::system_clock::to_time_t(now);
-              std::tm tm;
-#ifdef _WIN32
-              localtime_s(&tm, &time_tt);
-#else
-              localtime_r(&time_tt, &tm);
-#endif
-              std::ostringstream os;
-              os << std::put_time(&tm, "%H-%M-%S");
-              return os.str();
-          }()),
-          tag(tag) {
-    }
-    Level level = Level::Info;
-    std::string filename;
-    long line;
-    std::string timestamp;
-    std::string tag;
-};  // Metadata
+template <typename Base, typename T>
+inline void insert(rlog_ostream<Base>& os, const T& value) {
+    os << value;
+}
 
-/**
- * @brief A type that outputs given metadata and message
- *        Being a std::function, it can capture any callable
- *        with signature void(const Metadata&, const std::string&)
- */
-using Sink = std::function<void(const Metadata&, const std::string&)>;
+}  // namespace rlog_detail
 
 // -----------------------------------------------------------
 
-namespace internal {
-
-/// all things in namespace internal are for internal use only
+namespace R {
 
 // -----------------------------------------------------------
 
 /**
- * @brief Singleton that holds all global state of RLog
- *          i.e. severity level and active sinks
- *        Write accesses to these members is mutex protected
+ * @brief Severity levels
  */
-struct Store {
-    // ------------------------------
-    // locks every write access to any store members
-    std::recursive_mutex mutex;
-    /**/ std::vector<Sink> sinks;
-    /**/ Level level;
-    // ------------------------------
-    /**
-     * @brief getter for store singleton
-     * @return Store&
-     */
-    static Store& instance() {
-        // init of static function locals is threadsafe in c++11
-        static Store store;
-        return store;
-    }
-};  // Store
-
-// -----------------------------------------------------------
-
-}  // namespace internal
+enum Level { Info, Warning, Error, Off };
 
 // -----------------------------------------------------------
 
 /**
- * @brief Inits / resets all global state of RLog
- *        Sets level to specified
- *        Clears all existing global Sinks
- *        Best called atleast once from a single-threaded init context
- * @param global level. default: Info
+ * @brief Queueing strategies of async mode
+ *        Shared: one lock-free queue for all threads
+ *        PerThread: one queue per logging thread, merged by the backend,
+ *          so that logging threads never write to a shared cache line
  */
-static void reset(Level level = Level::Info) {
-    std::lock_guard<std::recursive_mutex> lock(
-        internal::Store::instance().mutex);
-    internal::Store::instance().level = level;
-    internal::Store::instance().sinks.clear();
-}
+enum class AsyncMode { Shared, PerThread };
 
 // -----------------------------------------------------------
 
 /**
- * @brief Adds a new global Sink
- * @param sink: copyable Sink instance
+ * @brief Thread safety of a Sink, see R::addSink
+ *        Serialized: called by one logging thread at a time, under a
+ *          mutex of its own
+ *        ThreadSafe: called by all logging threads at once, as it
+ *          synchronizes itself, if at all needed
+ *        Confined: called only by a dedicated thread of its own, to
+ *          which logs are queued
  */
-static void addSink(const Sink& sink) {
-    std::lock_guard<std::recursive_mutex> lock(
-        internal::Store::instance().mutex);
-    internal::Store::instance().sinks.push_back(sink);
-}
+enum class SinkPolicy { Serialized, ThreadSafe, Confined };
 
 // -----------------------------------------------------------
 
 /**
- * @brief Returns global level
- * @return Level
+ * @brief Run-time state of a logging call site, see R::sites
+ *        ByLevel: filtered by global and tag levels, as by default
+ *        Enabled: always logs, whatever the levels
+ *        Disabled: never logs
  */
-static inline Level level() { return internal::Store::instance().level; }
+enum class SiteState { ByLevel, Enabled, Disabled };
 
 // -----------------------------------------------------------
 
-namespace internal {
-
-/// all things in namespace internal are for internal use only
+/**
+ * @brief Description of a registered logging call site, see R::sites
+ */
+struct SiteInfo {
+    std::string filename;
+    long line;
+    Level level;
+    std::string tag;
+    SiteState state;
+};
 
 // -----------------------------------------------------------
 
 /**
- * @brief Single Log entry
- *        Every time a log is made, an instance of this class is created
- *          and the member ostringstream is filled
- *        Destructor passes the stream to all the active Sinks
+ * @brief Non-owning reference to a string, i.e. pointer & size
+ *        Lets Metadata expose strings without copying them per log
+ *        Converts implicitly to std::string
  */
-struct Log {
-    Log(Level level,
-        const std::string& filename,
-        long line,
-        const std::string& tag = "")
-        : metadata(level, filename, line, tag) {}
-    std::ostringstream& stream() { return os; }
-    ~Log() {
-        // prevent concurrent use
-        std::lock_guard<std::recursive_mutex> lock(Store::instance().mutex);
-        for (auto& sink : Store::instance().sinks) {
-            sink(metadata, os.str());
-        }
-    }
-    std::ostringstream os;
-    Metadata metadata;
-};  // Log
+struct StringRef {
+    constexpr StringRef() {}
+    StringRef(const char* data) : ptr(data), length(std::strlen(data)) {}
+    constexpr StringRef(const char* data, size_t size)
+        : ptr(data), length(size) {}
+    StringRef(const std::string& str) : ptr(str.data()), length(str.size()) {}
+    constexpr const char* data() const { return ptr; }
+    constexpr size_t size() const { return length; }
+    constexpr bool empty() const { return length == 0; }
+    constexpr const char* begin() const { return ptr; }
+    constexpr const char* end() const { return ptr + length; }
+    std::string str() const { return std::string(ptr, length); }
+    operator std::string() const { return str(); }
+    const char* ptr = "";
+    size_t length = 0;
+};  // StringRef
 
-// -----------------------------------------------------------
+static inline bool operator==(StringRef a, StringRef b) {
+    return a.size() == b.size() &&
+           std::char_traits<char>::compare(a.data(), b.data(), a.size()) == 0;
+}
 
-}  // namespace internal
+static inline bool operator!=(StringRef a, StringRef b) { return !(a == b); }
 
-// -----------------------------------------------------------
+static inline std::ostream& operator<<(std::ostream& os, StringRef str) {
+    return os.write(str.data(), str.size());
+}
 
-/**
- * @brief Returns string name of specified level
- *
- * @param level
- * @return std::string
- */
-static std::string to_string(Level level) {
-    switch (level) {
-        case Level::Info:
-            return "Info";
-        case Level::Warning:
-            return "Warning";
-        case Level::Error:
-            return "Error";
-        case Level::Off:
-            return "Off";
-        default:
-            assert(false);
-            return "None";
-    }
+static inline std::string operator+(const std::string& a, StringRef b) {
+    return std::string(a).append(b.data(), b.size());
+}
+
+static inline std::string operator+(StringRef a, const std::string& b) {
+    return a.str().append(b);
 }
 
 // -----------------------------------------------------------
@@ -373,83 +582,4230 @@ namespace internal {
 // -----------------------------------------------------------
 
 /**
- * @brief Function: string_replace
- *        Replaces a pattern in a string with another string
- * @param in: string where the search and replacement is done: std::string&
- * @param pattern: const std:string&
- * @param with: string replaced with: const std:string&
+ * @brief Helpers of basename
+ *        Single-return, to be constexpr in c++11
+ *        Split the range in halves, so that recursion depth stays
+ *          logarithmic even for very long paths
  */
-static void string_replace(std::string& in,
-                           const std::string& pattern,
-                           const std::string& with) {
-    size_t pos = in.find(pattern);
-    if (pos != std::string::npos) {
-        in.replace(pos, pattern.length(), with);
-    }
-}
-
-// -----------------------------------------------------------
+static constexpr bool isSeparator(char c) { return c == '/' || c == '\\'; }
 
-}  // namespace internal
+static constexpr size_t npos = static_cast<size_t>(-1);
 
-// -----------------------------------------------------------
+static constexpr size_t rightmost(size_t right, size_t left) {
+    return right != npos ? right : left;
+}
 
-/**
- * @brief A type that helps a sink filter logging based on metadata and
- * message Being a std::function, it can capture any callable with signature
- * bool(const Metadata&, const std::string&) Returned value can be used by a
- * Sink to filter logging
- */
-using Filter = std::function<bool(const Metadata&, const std::string&)>;
+static constexpr size_t lastSeparator(const char* path,
+                                      size_t begin,
+                                      size_t end) {
+    return end - begin == 0
+               ? npos
+               : end - begin == 1
+                     ? (isSeparator(path[begin]) ? begin : npos)
+                     : rightmost(
+                           lastSeparator(
+                               path, begin + (end - begin) / 2, end),
+                           lastSeparator(
+                               path, begin, begin + (end - begin) / 2));
+}
 
-// -----------------------------------------------------------
+static constexpr StringRef basename(const char* path,
+                                    size_t size,
+                                    size_t separator) {
+    return separator == npos
+               ? StringRef(path, size)
+               : StringRef(path + separator + 1, size - separator - 1);
+}
 
 /**
- * @brief A utility function to compose a given filter and sink to form a
- * new sink
+ * @brief Separates filename from full path
+ *        constexpr, so that it is resolved at compile time for __FILE__
+ * @param path: const char*
+ * @param size: length of path
+ * @return StringRef, into path
  */
-static const auto makeFilteredSink = [](const Sink& sink,
-                                        const Filter& filter) -> Sink {
-    return R_SINK_W_CAPTURE(metadata, message, =) {
-        if (filter(metadata, message)) {
-            sink(metadata, message);
-        }
-    };
-};
-
-// -----------------------------------------------------------
+static constexpr StringRef basename(const char* path, size_t size) {
+    return basename(path, size, lastSeparator(path, 0, size));
+}
 
 /**
- * @brief A type that helps a sink format its logs based on metadata and
- * message Being a std::function, it can capture any callable with signature
- * std::string(const Metadata&, const std::string&) Returned value can be
- * used by a Sink instead of raw message
+ * @brief Separates filename from full path
+ * @param path: StringRef
+ * @return StringRef, into path
  */
-using Formatter =
-    std::function<std::string(const Metadata&, const std::string&)>;
+static inline StringRef basename(StringRef path) {
+    return basename(path.data(), path.size());
+}
 
 // -----------------------------------------------------------
 
 /**
- * @brief A utility function to compose a given filter and formatter to form
- * a new sink
+ * @brief Per call site state of rate limiting logging macros
+ *          e.g. R_INFO_EVERY_N
+ *        Counts calls that are suppressed, so that the next log made
+ *          can report them
  */
-static const auto makeFormattedSink = [](const Sink& sink,
-                                         const Formatter& formatter) -> Sink {
-    return R_SINK_W_CAPTURE(metadata, message, =) {
-        sink(metadata, formatter(metadata, message));
-    };
-};
+struct Limiter {
+    /**
+     * @brief Admits the first of every n calls
+     * @param n: unsigned long long
+     * @return bool
+     */
+    bool everyN(unsigned long long n) {
+        if (n <= 1 || hits.fetch_add(1, std::memory_order_relaxed) % n == 0) {
+            return true;
+        }
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    /**
+     * @brief Admits a call only if none was in the last period
+     *        Concurrent calls race for the first one of a period
+     * @param ms: long long, period in milliseconds
+     * @return bool
+     */
+    bool everyMs(long long ms) {
+        const long long now =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count() +
+            1;  // so that 0 means never
+        long long previous = last.load(std::memory_order_relaxed);
+        if ((previous == 0 || now - previous >= ms) &&
+            last.compare_exchange_strong(
+                previous, now, std::memory_order_relaxed)) {
+            return true;
+        }
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    /**
+     * @brief Admits the first n calls
+     *        Later calls are not counted as suppressed, since no later
+     *          log reports them
+     * @param n: unsigned long long
+     * @return bool
+     */
+    bool firstN(unsigned long long n) {
+        // no write to a shared cache line once exhausted
+        return hits.load(std::memory_order_relaxed) < n &&
+               hits.fetch_add(1, std::memory_order_relaxed) < n;
+    }
+    /**
+     * @brief Returns calls suppressed since last called, resetting them
+     * @return unsigned long long
+     */
+    unsigned long long take() {
+        // no write unless something was suppressed
+        return suppressed.load(std::memory_order_relaxed)
+                   ? suppressed.exchange(0, std::memory_order_relaxed)
+                   : 0;
+    }
+    // calls so far, for everyN and firstN
+    std::atomic<unsigned long long> hits{0};
+    // steady time in ms plus one, of last admitted call, for everyMs
+    std::atomic<long long> last{0};
+    std::atomic<unsigned long long> suppressed{0};
+};  // Limiter
 
 // -----------------------------------------------------------
 
 /**
- * @brief A built-in basic cout sink
- * @note Adds an endl and therefore a flush after every log
+ * @brief Sampling decisions of sampling logging macros
+ *          e.g. R_INFO_SAMPLED
  */
-static const Sink CoutSink = R_SINK(metadata, message) {
-    std::cout << message << std::endl;
-};
+struct Sampler {
+    /**
+     * @brief Keeps a random fraction of calls
+     *        Uses a thread-local xorshift generator, i.e. one shift-xor
+     *          step per call, and no shared state
+     * @param rate: double, in [0, 1]
+     * @return bool
+     */
+    static bool keep(double rate) { return below(next(), rate); }
+    /**
+     * @brief Keeps a fraction of keys, always deciding the same for a key
+     * @param rate: double, in [0, 1]
+     * @param key: integer
+     * @return bool
+     */
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value,
+                                      int>::type = 0>
+    static bool keep(double rate, T key) {
+        return below(mix(static_cast<uint64_t>(key)), rate);
+    }
+    /**
+     * @brief Keeps a fraction of keys, always deciding the same for a key
+     *        Hashed with FNV-1a, which unlike std::hash is the same on
+     *          every platform, so that services agree on kept keys
+     * @param rate: double, in [0, 1]
+     * @param key: StringRef
+     * @return bool
+     */
+    static bool keep(double rate, StringRef key) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const char c : key) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        }
+        return below(mix(hash), rate);
+    }
+    // ------------------------------
+    /**
+     * @brief Compares a random or hashed value with a rate
+     * @param value: uint64_t, uniformly distributed
+     * @param rate: double
+     * @return bool, true for a fraction rate of values
+     */
+    static bool below(uint64_t value, double rate) {
+        // top 53 bits, as a double in [0, 1)
+        return (value >> 11) * (1.0 / 9007199254740992.0) < rate;
+    }
+    /**
+     * @brief Returns next value of calling thread's xorshift64* generator
+     * @return uint64_t
+     */
+    static uint64_t next() {
+        static thread_local uint64_t state = seed();
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dull;
+    }
+    /**
+     * @brief Returns a distinct non-zero seed per thread
+     * @return uint64_t
+     */
+    static uint64_t seed() {
+        const uint64_t seed = mix(
+            std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+            static_cast<uint64_t>(
+                std::chrono::steady_clock::now().time_since_epoch().count()));
+        return seed ? seed : 1;
+    }
+    /**
+     * @brief Scrambles all bits of a value, i.e. splitmix64 finalizer
+     * @param value: uint64_t
+     * @return uint64_t
+     */
+    static uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+};  // Sampler
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Static descriptor of a single logging call site
+ *          i.e. level, filename & line
+ *        Every logging macro owns one, so that these are not computed
+ *          per log
+ *        Has a constexpr constructor, so that it is initialized at
+ *          compile time, and its use needs no guard check
+ */
+struct Site {
+    constexpr Site(Level level, StringRef filename, long line)
+        : level(level), filename(filename), line(line) {}
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(Site);
+    const Level level;
+    const StringRef filename;
+    const long line;
+    // ------------------------------
+    // effective level of the tag logged at this site, see Levels::resolve
+    mutable std::atomic<const char*> cachedTag{nullptr};
+    mutable std::atomic<unsigned> cachedLevel{0};
+    // registry state, only accessed with Levels::mutex locked
+    mutable bool registered = false;
+    mutable SiteState state = SiteState::ByLevel;
+    // state of rate limiting macros
+    mutable Limiter limiter;
+};  // Site
+
+// -----------------------------------------------------------
+
+struct ArgBuffer;
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+namespace internal {
+
+/// all things in namespace internal are for internal use only
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Two digit decimal strings of 0 to 99, back to back
+ *        Lets integers be converted two digits at a time
+ */
+static constexpr char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343"
+    "53637383940414243444546474849505152535455565758596061626364656667686970"
+    "71727374757677787980818283848586878889909192939495969798990";
+
+/**
+ * @brief Local time of day of the last second formatted by a thread
+ *        Converting to local time takes a lock in libc, and is only
+ *        needed once a second, as logs of the same second share it
+ */
+struct TimeOfDay {
+    static constexpr long long noSecond =
+        std::numeric_limits<long long>::min();
+    // seconds since epoch of text
+    long long second = noSecond;
+    // %H-%M-%S
+    char text[8];
+    /**
+     * @brief Formats specified second, if not already formatted
+     * @param seconds: long long, since epoch
+     */
+    void update(long long seconds) {
+        if (seconds == second) {
+            return;
+        }
+        std::time_t time_tt = static_cast<std::time_t>(seconds);
+        std::tm tm;
+#ifdef _WIN32
+        localtime_s(&tm, &time_tt);
+#else
+        localtime_r(&time_tt, &tm);
+#endif
+        const int parts[] = {tm.tm_hour, tm.tm_min, tm.tm_sec};
+        for (size_t i = 0; i < 3; ++i) {
+            text[i * 3] = digitPairs[parts[i] * 2];
+            text[i * 3 + 1] = digitPairs[parts[i] * 2 + 1];
+        }
+        text[2] = text[5] = '-';
+        second = seconds;
+    }
+};  // TimeOfDay
+
+/**
+ * @brief Formats a time as local time of day, i.e. %H-%M-%S
+ * @param time: long long, nanoseconds since epoch
+ * @return std::string
+ */
+static std::string timestamp(long long time) {
+    static thread_local TimeOfDay cache;
+    cache.update(time / 1000000000);
+    return std::string(cache.text, sizeof(cache.text));
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Clock of logs, reading system_clock
+ *        Ticks are already nanoseconds since epoch
+ */
+struct SystemClock {
+    /**
+     * @brief Returns current reading of the clock
+     * @return long long
+     */
+    static long long ticks() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+    /**
+     * @brief Converts a reading to nanoseconds since epoch
+     * @param ticks: long long
+     * @return long long
+     */
+    static long long time(long long ticks) { return ticks; }
+};  // SystemClock
+
+// -----------------------------------------------------------
+
+#if R_INTERNAL_X86
+
+/**
+ * @brief Clock of logs, reading the time stamp counter of the cpu
+ *        Ticks are mapped to wall time by a calibration, made by a thread
+ *          of its own, started by the first reading, which refreshes it
+ *          once a period, so that logging threads only read the counter
+ *        The thread is stopped & joined with static objects, at exit or
+ *          when a shared library holding it is unloaded
+ *        A refresh keeps converted time continuous, and slews its rate
+ *          to meet system_clock again after the next period, so that
+ *          time never goes back, unless system_clock is stepped
+ *        With R_SINGLE_THREADED, the first reading calibrates, and a
+ *          conversion that finds the calibration stale refreshes it
+ *        Without an invariant counter, ticks are those of SystemClock
+ */
+template <typename = void>
+struct TscClock {
+    // nanoseconds per calibration period
+    static constexpr long long periodNs = 1000000000;
+    // most a refresh slews in a period, i.e. 500 ppm, beyond it time is
+    // stepped
+    static constexpr long long maxSlewNs = periodNs / 2000;
+    // ------------------------------
+    // calibration, only written by the calibrating thread, read by a
+    // sequence lock
+    static std::atomic<unsigned> sequence;
+    static std::atomic<long long> baseTicks;
+    static std::atomic<long long> baseTime;
+    static std::atomic<double> rate;  // nanoseconds per tick
+    // ticks from which the calibration is stale, 0 until the first one
+    static std::atomic<long long> nextTicks;
+    // first reading of counter and steady_clock, to measure the rate
+    // over as long a time as possible
+    static long long firstTicks;
+    static long long firstSteady;
+    // ------------------------------
+    /**
+     * @brief Returns whether the cpu has an invariant counter, i.e. one
+     *          ticking at a constant rate, in sync across cores
+     * @return bool
+     */
+    static bool invariant() {
+        static const bool invariant = [] {
+            unsigned regs[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0x80000000);
+            if (static_cast<unsigned>(info[0]) >= 0x80000007) {
+                __cpuid(info, 0x80000007);
+                regs[3] = static_cast<unsigned>(info[3]);
+            }
+#else
+            __get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+            return (regs[3] & (1u << 8)) != 0;
+        }();
+        return invariant;
+    }
+    /**
+     * @brief Returns whether ticks are read from the counter, starting its
+     *          calibration on first call
+     * @return bool
+     */
+    static bool counting() {
+        static const bool counting = invariant() && start();
+        return counting;
+    }
+    /**
+     * @brief Returns current reading of the clock
+     * @return long long
+     */
+    static long long ticks() {
+        return counting() ? counter() : SystemClock::ticks();
+    }
+    /**
+     * @brief Converts a reading to nanoseconds since epoch
+     * @param ticks: long long
+     * @return long long
+     */
+    static long long time(long long ticks) {
+        if (!counting()) {
+            return SystemClock::time(ticks);
+        }
+#if R_SINGLE_THREADED
+        // no thread of its own to refresh it
+        if (ticks >= nextTicks.load(std::memory_order_relaxed)) {
+            refresh();
+        }
+#else
+        // only ever waits for the first calibration, right after start
+        while (nextTicks.load(std::memory_order_acquire) == 0) {
+            std::this_thread::yield();
+        }
+#endif
+        return convert(ticks);
+    }
+    // ------------------------------
+    static long long counter() { return static_cast<long long>(__rdtsc()); }
+    static long long steady() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+#if !R_SINGLE_THREADED
+    /**
+     * @brief Thread that makes the first calibration, and refreshes it
+     *          once a period, until destroyed
+     */
+    struct Calibrator {
+        Calibrator() : thread([this] { run(); }) {}
+        R_INTERNAL_DISALLOW_COPY_ASSIGN(Calibrator);
+        ~Calibrator() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+        void run() {
+            calibrate();
+            const std::chrono::nanoseconds period(
+                static_cast<long long>(periodNs));
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wake.wait_for(lock, period, [this] { return stopping; })) {
+                refresh();
+            }
+        }
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::thread thread;
+    };  // Calibrator
+#endif
+    /**
+     * @brief Makes the first calibration, and keeps it fresh
+     * @return bool, true
+     */
+    static bool start() {
+#if R_SINGLE_THREADED
+        calibrate();
+#else
+        // stopped after the statics constructed later are destroyed
+        static Calibrator calibrator;
+#endif
+        return true;
+    }
+    /**
+     * @brief Reads counter together with steady_clock, retrying until
+     *          both are read within a microsecond of each other
+     * @param ticks: long long&
+     * @return long long, steady_clock at ticks
+     */
+    static long long sample(long long& ticks) {
+        for (int i = 0;; ++i) {
+            const long long before = steady();
+            ticks = counter();
+            const long long after = steady();
+            if (after - before < 1000 || i == 100) {
+                return before + (after - before) / 2;
+            }
+        }
+    }
+    /**
+     * @brief Converts a reading by current calibration
+     * @param ticks: long long
+     * @return long long
+     */
+    static long long convert(long long ticks) {
+        long long fromTicks, fromTime;
+        double nsPerTick;
+        unsigned before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            fromTicks = baseTicks.load(std::memory_order_relaxed);
+            fromTime = baseTime.load(std::memory_order_relaxed);
+            nsPerTick = rate.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+        return fromTime +
+               static_cast<long long>((ticks - fromTicks) * nsPerTick);
+    }
+    static void publish(long long ticks, long long time, double nsPerTick) {
+        const unsigned current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        baseTicks.store(ticks, std::memory_order_relaxed);
+        baseTime.store(time, std::memory_order_relaxed);
+        rate.store(nsPerTick, std::memory_order_relaxed);
+        sequence.store(current + 2, std::memory_order_release);
+        nextTicks.store(ticks + static_cast<long long>(periodNs / nsPerTick),
+                        std::memory_order_release);
+    }
+    /**
+     * @brief Makes the first calibration, measuring the rate over a couple
+     *          of milliseconds
+     */
+    static void calibrate() {
+        firstSteady = sample(firstTicks);
+        long long ticks, now;
+        do {
+            now = sample(ticks);
+        } while (now - firstSteady < 2000000);
+        const double nsPerTick =
+            double(now - firstSteady) / double(ticks - firstTicks);
+        publish(ticks, SystemClock::ticks(), nsPerTick);
+    }
+    /**
+     * @brief Refreshes the calibration, measuring the rate since the first
+     */
+    static void refresh() {
+        long long ticks;
+        const long long now = sample(ticks);
+        const double nsPerTick =
+            double(now - firstSteady) / double(ticks - firstTicks);
+        const long long wall = SystemClock::ticks();
+        const long long time = convert(ticks);
+        const long long offset = wall - time;
+        if (offset > maxSlewNs || offset < -maxSlewNs) {
+            publish(ticks, wall, nsPerTick);
+        } else {
+            publish(ticks,
+                    time,
+                    nsPerTick * double(periodNs + offset) / double(periodNs));
+        }
+    }
+};  // TscClock
+
+template <typename T>
+std::atomic<unsigned> TscClock<T>::sequence(0);
+template <typename T>
+std::atomic<long long> TscClock<T>::baseTicks(0);
+template <typename T>
+std::atomic<long long> TscClock<T>::baseTime(0);
+template <typename T>
+std::atomic<double> TscClock<T>::rate(0);
+template <typename T>
+std::atomic<long long> TscClock<T>::nextTicks(0);
+template <typename T>
+long long TscClock<T>::firstTicks = 0;
+template <typename T>
+long long TscClock<T>::firstSteady = 0;
+
+#endif
+
+/**
+ * @brief Clock of logs, as selected by R_TSC_CLOCK
+ */
+#if R_TSC_CLOCK && R_INTERNAL_X86
+using Clock = TscClock<>;
+#else
+using Clock = SystemClock;
+#endif
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Typed key / value pair attached to a log
+ *        e.g. R_INFO("req").kv("user", id) << "done";
+ * @note key and string are only references, valid while the log is
+ *         passed to the sinks
+ */
+struct Field {
+    enum Type { Bool, Int, UInt, Double, String };
+    StringRef key;
+    Type type = Int;
+    union {
+        bool boolean;
+        long long integer = 0;
+        unsigned long long uinteger;
+        double real;
+    };
+    // value of String fields
+    StringRef string;
+};  // Field
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Non-owning reference to the fields of a log, i.e. pointer & size
+ */
+struct Fields {
+    constexpr Fields() {}
+    constexpr Fields(const Field* data, size_t size)
+        : ptr(data), length(size) {}
+    constexpr const Field* begin() const { return ptr; }
+    constexpr const Field* end() const { return ptr + length; }
+    constexpr size_t size() const { return length; }
+    constexpr bool empty() const { return length == 0; }
+    const Field& operator[](size_t i) const { return ptr[i]; }
+    /**
+     * @brief Returns first field with specified key
+     * @param key: StringRef
+     * @return const Field*, nullptr if there is none
+     */
+    const Field* find(StringRef key) const {
+        for (const auto& field : *this) {
+            if (field.key == key) {
+                return &field;
+            }
+        }
+        return nullptr;
+    }
+    const Field* ptr = nullptr;
+    size_t length = 0;
+};  // Fields
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Holds metadata of a log, i.e.
+ *          level, filename, line, time, timestamp & tag
+ *        Gets passed to the filters, formatters & sinks
+ * @note filename and tag are only references, valid while the log is
+ *         passed to the sinks. Copy them to keep them longer
+ * @note time is converted from ticks, and timestamp formatted from it,
+ *         on first use, so they are not thread safe to use on the same
+ *         metadata from many threads
+ */
+struct Metadata {
+    Metadata() {}
+    Metadata(Level level,
+             StringRef filename,
+             long line,
+             StringRef tag = StringRef())
+        : Metadata(level, internal::basename(filename), line, tag, nullptr) {}
+    Metadata(const internal::Site& site, StringRef tag)
+        : Metadata(site.level, site.filename, site.line, tag, &site) {}
+    Metadata(Level level,
+             StringRef filename,
+             long line,
+             StringRef tag,
+             const internal::Site* site)
+        : site(site),
+          level(level),
+          filename(filename),
+          line(line),
+          // capture current time, converted only when asked for
+          ticks(internal::Clock::ticks()),
+          tag(tag) {
+    }
+    /**
+     * @brief Nanoseconds since epoch of the log
+     *        Converted from ticks on first use, unless time was set, so
+     *          that logs are timed by a mere reading of the clock
+     * @return long long
+     */
+    long long nanoseconds() const {
+        if (time == unconverted) {
+            time = internal::Clock::time(ticks);
+        }
+        return time;
+    }
+    /**
+     * @brief Local time of day of the log, i.e. %H-%M-%S
+     *        Formatted on first use, so logs nobody prints the time of
+     *          never pay for it
+     * @return const std::string&
+     */
+    const std::string& timestamp() const {
+        const long long time = nanoseconds();
+        if (stamp.empty() || stampTime != time) {
+            stamp = internal::timestamp(time);
+            stampTime = time;
+        }
+        return stamp;
+    }
+    // time of metadata not converted from ticks yet
+    static constexpr long long unconverted =
+        std::numeric_limits<long long>::min();
+    // call site of the log, if made by a logging macro
+    const internal::Site* site = nullptr;
+    Level level = Level::Info;
+    StringRef filename;
+    long line = 0;
+    // raw reading of the clock, i.e. time stamp counter with R_TSC_CLOCK
+    long long ticks = 0;
+    // nanoseconds since epoch, see nanoseconds()
+    mutable long long time = unconverted;
+    StringRef tag;
+    // logs suppressed at the same call site since the previous one,
+    // by rate limiting macros, e.g. R_INFO_EVERY_N
+    unsigned long long suppressed = 0;
+    // typed key / value pairs, added with kv
+    Fields fields;
+    // typed arguments the message was rendered from, with
+    // R_DEFERRED_FORMAT, valid while the log is passed to the sinks
+    const internal::ArgBuffer* args = nullptr;
+    // memo of timestamp, and time it was formatted from
+    mutable std::string stamp;
+    mutable long long stampTime = 0;
+};  // Metadata
+
+/**
+ * @brief A type that outputs given metadata and message
+ *        Being a std::function, it can capture any callable
+ *        with signature void(const Metadata&, const std::string&)
+ */
+using Sink = std::function<void(const Metadata&, const std::string&)>;
+
+// -----------------------------------------------------------
+
+namespace internal {
+
+/// all things in namespace internal are for internal use only
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Size of a buffer that fits any number formatted by rlog
+ */
+static constexpr size_t numberSize = 64;
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Writes decimal digits of value, backwards from end
+ * @param end: one past the last digit
+ * @param value: unsigned long long
+ * @return pointer to the first digit
+ */
+static inline char* formatDecimal(char* end, unsigned long long value) {
+    while (value >= 100) {
+        const size_t pair = static_cast<size_t>(value % 100) * 2;
+        value /= 100;
+        *--end = digitPairs[pair + 1];
+        *--end = digitPairs[pair];
+    }
+    if (value >= 10) {
+        const size_t pair = static_cast<size_t>(value) * 2;
+        *--end = digitPairs[pair + 1];
+        *--end = digitPairs[pair];
+    } else {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+/**
+ * @brief Writes decimal digits of value, with its sign, backwards from end
+ * @param end: one past the last digit
+ * @param value: long long
+ * @return pointer to the first character
+ */
+static inline char* formatDecimal(char* end, long long value) {
+    const unsigned long long magnitude =
+        value < 0 ? 0ull - static_cast<unsigned long long>(value)
+                  : static_cast<unsigned long long>(value);
+    end = formatDecimal(end, magnitude);
+    if (value < 0) {
+        *--end = '-';
+    }
+    return end;
+}
+
+/**
+ * @brief Writes lowercase hex digits of value, with 0x prefix,
+ *          backwards from end
+ * @param end: one past the last digit
+ * @param value: unsigned long long
+ * @return pointer to the first character
+ */
+static inline char* formatHex(char* end, unsigned long long value) {
+    do {
+        *--end = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value);
+    *--end = 'x';
+    *--end = '0';
+    return end;
+}
+
+/**
+ * @brief Writes value as std::ostream does by default, i.e. like %g
+ *        Integral values below a million, which %g shows exactly,
+ *          are converted as integers
+ * @param out: buffer of numberSize chars
+ * @param value: double
+ * @return number of chars written
+ */
+static inline size_t formatFloat(char* out, double value) {
+    if (value > -1e6 && value < 1e6 &&
+        value == static_cast<double>(static_cast<long long>(value)) &&
+        !(value == 0 && std::signbit(value))) {
+        char* const end = out + numberSize;
+        char* const begin =
+            formatDecimal(end, static_cast<long long>(value));
+        std::memmove(out, begin, end - begin);
+        return end - begin;
+    }
+    return snprintf(out, numberSize, "%g", value);
+}
+
+/**
+ * @brief Writes value as std::ostream does by default, i.e. like %Lg
+ * @param out: buffer of numberSize chars
+ * @param value: long double
+ * @return number of chars written
+ */
+static inline size_t formatFloat(char* out, long double value) {
+    return snprintf(out, numberSize, "%Lg", value);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Storage of the fields added to a log with kv
+ *        Fields live in an inline array, spilling to the heap only
+ *          beyond R_FIELDS_INLINE_COUNT
+ *        Keys and string values given as char arrays are expected to be
+ *          string literals and are referenced, others are copied into a
+ *          single buffer, as they may be temporaries
+ */
+struct FieldList {
+    FieldList() {}
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(FieldList);
+    // ------------------------------
+    template <typename K, typename V>
+    void add(const K& key, const V& value) {
+        Field& field = next();
+        field.key = keep(key);
+        set(field, value);
+    }
+    /**
+     * @brief Returns a view of the fields added so far
+     * @return Fields
+     */
+    Fields view() const {
+        return Fields(count > sizeof(local) / sizeof(Field) ? spill.data()
+                                                             : local,
+                      count);
+    }
+    void clear() {
+        count = 0;
+        spill.clear();
+        text.clear();
+    }
+    // ------------------------------
+    void set(Field& field, bool value) {
+        field.type = Field::Bool;
+        field.boolean = value;
+    }
+    void set(Field& field, char value) {
+        field.type = Field::String;
+        field.string = copy(StringRef(&value, 1));
+    }
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value &&
+                                          std::is_signed<T>::value,
+                                      int>::type = 0>
+    void set(Field& field, T value) {
+        field.type = Field::Int;
+        field.integer = value;
+    }
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value &&
+                                          std::is_unsigned<T>::value,
+                                      int>::type = 0>
+    void set(Field& field, T value) {
+        field.type = Field::UInt;
+        field.uinteger = value;
+    }
+    template <typename T,
+              typename std::enable_if<std::is_floating_point<T>::value,
+                                      int>::type = 0>
+    void set(Field& field, T value) {
+        field.type = Field::Double;
+        field.real = static_cast<double>(value);
+    }
+    template <size_t N>
+    void set(Field& field, const char (&value)[N]) {
+        field.type = Field::String;
+        field.string = keep(value);
+    }
+    void set(Field& field, StringRef value) {
+        field.type = Field::String;
+        field.string = keep(value);
+    }
+    /**
+     * @brief Any other type is stored as string, using its
+     *          std::ostream << operator
+     */
+    template <typename T,
+              typename std::enable_if<
+                  !std::is_arithmetic<T>::value &&
+                      !std::is_convertible<const T&, StringRef>::value,
+                  int>::type = 0>
+    void set(Field& field, const T& value) {
+        rlog_ostream<std::ostringstream> os;
+        ::rlog_detail::insert(os, value);
+        set(field, StringRef(os.str()));
+    }
+    // ------------------------------
+    template <size_t N>
+    StringRef keep(const char (&value)[N]) {
+        return StringRef(value);
+    }
+    StringRef keep(StringRef value) { return copy(value); }
+    /**
+     * @brief Copies chars into text, which all copied keys and values share
+     * @param value: StringRef
+     * @return StringRef, into text
+     */
+    StringRef copy(StringRef value) {
+        const char* const before = text.data();
+        const size_t offset = text.size();
+        text.append(value.data(), value.size());
+        if (text.data() != before) {
+            // text moved, so do all the copies made so far
+            rebase(before, offset);
+        }
+        return StringRef(text.data() + offset, value.size());
+    }
+    void rebase(const char* before, size_t size) {
+        const uintptr_t base = reinterpret_cast<uintptr_t>(before);
+        const auto moved = [&](StringRef& ref) {
+            const uintptr_t at = reinterpret_cast<uintptr_t>(ref.data());
+            if (at >= base && at - base <= size) {
+                ref = StringRef(text.data() + (at - base), ref.size());
+            }
+        };
+        Field* const fields = const_cast<Field*>(view().begin());
+        for (size_t i = 0; i < count; ++i) {
+            moved(fields[i].key);
+            if (fields[i].type == Field::String) {
+                moved(fields[i].string);
+            }
+        }
+    }
+    Field& next() {
+        const size_t inline_count = sizeof(local) / sizeof(Field);
+        if (count < inline_count) {
+            local[count] = Field();
+            return local[count++];
+        }
+        if (count == inline_count) {
+            spill.assign(local, local + inline_count);
+        }
+        spill.emplace_back();
+        ++count;
+        return spill.back();
+    }
+    // ------------------------------
+    Field local[R_FIELDS_INLINE_COUNT];
+    std::vector<Field> spill;
+    size_t count = 0;
+    // copies of keys and string values
+    std::string text;
+};  // FieldList
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Compact binary copy of the arguments streamed into a log
+ *        Every argument is stored as a type byte followed by its raw bytes,
+ *          and converted to text only when render is called
+ *        Small buffers live inline, larger ones spill to the heap
+ */
+struct ArgBuffer {
+    enum Type : unsigned char {
+        Bool,
+        Char,
+        Short,
+        UShort,
+        Int,
+        UInt,
+        Long,
+        ULong,
+        LongLong,
+        ULongLong,
+        Float,
+        Double,
+        LongDouble,
+        String,
+        Pointer,
+        Manipulator,
+        IosManipulator
+    };
+    using ManipulatorFn = std::ostream& (*)(std::ostream&);
+    using IosManipulatorFn = std::ios_base& (*)(std::ios_base&);
+    // ------------------------------
+    ArgBuffer() {}
+    ArgBuffer(const ArgBuffer& other) { *this = other; }
+    ArgBuffer(ArgBuffer&& other) { *this = std::move(other); }
+    ArgBuffer& operator=(const ArgBuffer& other) {
+        if (this != &other) {
+            clear();
+            append(other.data(), other.size);
+            replay = other.replay;
+        }
+        return *this;
+    }
+    ArgBuffer& operator=(ArgBuffer&& other) {
+        if (this != &other) {
+            heap = std::move(other.heap);
+            size = other.size;
+            replay = other.replay;
+            if (heap.empty()) {
+                std::memcpy(local, other.local, size);
+            }
+            other.clear();
+        }
+        return *this;
+    }
+    bool empty() const { return size == 0; }
+    void clear() {
+        size = 0;
+        replay = false;
+        // keeps capacity
+        heap.clear();
+    }
+    const char* data() const { return heap.empty() ? local : heap.data(); }
+    void append(const void* bytes, size_t count) {
+        if (heap.empty()) {
+            if (size + count <= sizeof(local)) {
+                std::memcpy(local + size, bytes, count);
+                size += count;
+                return;
+            }
+            heap.reserve(2 * (size + count));
+            heap.assign(local, size);
+        }
+        heap.append(static_cast<const char*>(bytes), count);
+        size += count;
+    }
+    template <typename T>
+    void put(Type type, const T& value) {
+        append(&type, 1);
+        append(&value, sizeof(T));
+    }
+    void putString(const char* text, size_t length) {
+        const Type type = String;
+        append(&type, 1);
+        append(&length, sizeof(length));
+        append(text, length);
+    }
+    template <typename T>
+    static T read(const char*& pos) {
+        T value;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    template <typename T, typename As>
+    static const char* decimal(char* end, const char*& pos) {
+        return formatDecimal(end, static_cast<As>(read<T>(pos)));
+    }
+    /**
+     * @brief Appends the text the arguments would have produced on an
+     *          std::ostream
+     *        Uses rlog's own number conversions, unless a pointer or
+     *          manipulator was streamed, in which case all arguments are
+     *          replayed on an std::ostringstream
+     * @param out: std::string&
+     */
+    void render(std::string& out) const {
+        if (replay) {
+            std::ostringstream os;
+            replayInto(os);
+            out += os.str();
+            return;
+        }
+        char number[numberSize];
+        char* const end = number + numberSize;
+        const char* pos = data();
+        const char* const last = pos + size;
+        while (pos != last) {
+            const char* begin = end;
+            switch (read<Type>(pos)) {
+                case Bool:
+                    out += read<bool>(pos) ? '1' : '0';
+                    break;
+                case Char:
+                    out += read<char>(pos);
+                    break;
+                case Short:
+                    begin = decimal<short, long long>(end, pos);
+                    break;
+                case UShort:
+                    begin =
+                        decimal<unsigned short, unsigned long long>(end, pos);
+                    break;
+                case Int:
+                    begin = decimal<int, long long>(end, pos);
+                    break;
+                case UInt:
+                    begin = decimal<unsigned, unsigned long long>(end, pos);
+                    break;
+                case Long:
+                    begin = decimal<long, long long>(end, pos);
+                    break;
+                case ULong:
+                    begin =
+                        decimal<unsigned long, unsigned long long>(end, pos);
+                    break;
+                case LongLong:
+                    begin = decimal<long long, long long>(end, pos);
+                    break;
+                case ULongLong:
+                    begin = decimal<unsigned long long, unsigned long long>(
+                        end, pos);
+                    break;
+                case Float:
+                    out.append(number, formatFloat(number, read<float>(pos)));
+                    break;
+                case Double:
+                    out.append(number, formatFloat(number, read<double>(pos)));
+                    break;
+                case LongDouble:
+                    out.append(number,
+                               formatFloat(number, read<long double>(pos)));
+                    break;
+                case String: {
+                    const size_t count = read<size_t>(pos);
+                    out.append(pos, count);
+                    pos += count;
+                } break;
+                default:
+                    // only ever replayed
+                    assert(false);
+                    return;
+            }
+            out.append(begin, end - begin);
+        }
+    }
+    /**
+     * @brief Streams the arguments on specified ostream, as they were
+     *          originally streamed
+     * @param os: std::ostream&
+     */
+    void replayInto(std::ostream& os) const {
+        const char* pos = data();
+        const char* const end = pos + size;
+        while (pos != end) {
+            switch (read<Type>(pos)) {
+                case Bool:
+                    os << read<bool>(pos);
+                    break;
+                case Char:
+                    os << read<char>(pos);
+                    break;
+                case Short:
+                    os << read<short>(pos);
+                    break;
+                case UShort:
+                    os << read<unsigned short>(pos);
+                    break;
+                case Int:
+                    os << read<int>(pos);
+                    break;
+                case UInt:
+                    os << read<unsigned>(pos);
+                    break;
+                case Long:
+                    os << read<long>(pos);
+                    break;
+                case ULong:
+                    os << read<unsigned long>(pos);
+                    break;
+                case LongLong:
+                    os << read<long long>(pos);
+                    break;
+                case ULongLong:
+                    os << read<unsigned long long>(pos);
+                    break;
+                case Float:
+                    os << read<float>(pos);
+                    break;
+                case Double:
+                    os << read<double>(pos);
+                    break;
+                case LongDouble:
+                    os << read<long double>(pos);
+                    break;
+                case String: {
+                    const size_t count = read<size_t>(pos);
+                    os.write(pos, count);
+                    pos += count;
+                } break;
+                case Pointer:
+                    os << read<const void*>(pos);
+                    break;
+                case Manipulator:
+                    os << read<ManipulatorFn>(pos);
+                    break;
+                case IosManipulator:
+                    os << read<IosManipulatorFn>(pos);
+                    break;
+            }
+        }
+    }
+    // ------------------------------
+    char local[R_DEFERRED_INLINE_SIZE];
+    std::string heap;
+    size_t size = 0;
+    // set when render has to go through an ostream
+    bool replay = false;
+};  // ArgBuffer
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Stream returned by a log in deferred format mode
+ *        Copies built-in types and strings into an ArgBuffer,
+ *          leaving the conversion to text for later
+ *        Any other type is converted right away, using its
+ *          std::ostream << operator
+ */
+struct ArgStream {
+    using Type = ArgBuffer::Type;
+    ArgStream& operator<<(bool value) { return put(Type::Bool, value); }
+    ArgStream& operator<<(char value) { return put(Type::Char, value); }
+    ArgStream& operator<<(signed char value) {
+        return put(Type::Char, static_cast<char>(value));
+    }
+    ArgStream& operator<<(unsigned char value) {
+        return put(Type::Char, static_cast<char>(value));
+    }
+    ArgStream& operator<<(short value) { return put(Type::Short, value); }
+    ArgStream& operator<<(unsigned short value) {
+        return put(Type::UShort, value);
+    }
+    ArgStream& operator<<(int value) { return put(Type::Int, value); }
+    ArgStream& operator<<(unsigned value) { return put(Type::UInt, value); }
+    ArgStream& operator<<(long value) { return put(Type::Long, value); }
+    ArgStream& operator<<(unsigned long value) {
+        return put(Type::ULong, value);
+    }
+    ArgStream& operator<<(long long value) {
+        return put(Type::LongLong, value);
+    }
+    ArgStream& operator<<(unsigned long long value) {
+        return put(Type::ULongLong, value);
+    }
+    ArgStream& operator<<(float value) { return put(Type::Float, value); }
+    ArgStream& operator<<(double value) { return put(Type::Double, value); }
+    ArgStream& operator<<(long double value) {
+        return put(Type::LongDouble, value);
+    }
+    ArgStream& operator<<(const char* value) {
+        // same as std::ostream, which prints nothing for nullptr
+        if (value) {
+            args.putString(value, std::strlen(value));
+        }
+        return *this;
+    }
+    ArgStream& operator<<(const std::string& value) {
+        args.putString(value.data(), value.size());
+        return *this;
+    }
+    ArgStream& operator<<(const void* value) {
+        args.replay = true;
+        return put(Type::Pointer, value);
+    }
+    ArgStream& operator<<(ArgBuffer::ManipulatorFn value) {
+        // common manipulators that only output a char, or nothing at all
+        if (value == static_cast<ArgBuffer::ManipulatorFn>(std::endl)) {
+            return put(Type::Char, '\n');
+        }
+        if (value == static_cast<ArgBuffer::ManipulatorFn>(std::ends)) {
+            return put(Type::Char, '\0');
+        }
+        if (value == static_cast<ArgBuffer::ManipulatorFn>(std::flush)) {
+            return *this;
+        }
+        args.replay = true;
+        return put(Type::Manipulator, value);
+    }
+    ArgStream& operator<<(ArgBuffer::IosManipulatorFn value) {
+        args.replay = true;
+        return put(Type::IosManipulator, value);
+    }
+    template <typename T>
+    ArgStream& operator<<(const T& value) {
+        rlog_ostream<std::ostringstream> os;
+        ::rlog_detail::insert(os, value);
+        return *this << os.str();
+    }
+    template <typename T>
+    ArgStream& put(Type type, const T& value) {
+        args.put(type, value);
+        return *this;
+    }
+    /**
+     * @brief Adds a typed key / value pair to the log
+     * @param key: string
+     * @param value: bool, number, string, or any type with an
+     *          std::ostream << operator
+     * @return ArgStream&
+     */
+    template <typename K, typename V>
+    ArgStream& kv(const K& key, const V& value) {
+        fields.add(key, value);
+        return *this;
+    }
+    ArgBuffer args;
+    FieldList fields;
+};  // ArgStream
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A log on its way to the Sinks
+ *        Can own its metadata and message, so that it can outlive the Log
+ *        In deferred format mode, message is rendered from args on first use
+ */
+struct Record {
+    Record() {}
+    Record(Metadata&& metadata, std::string&& message)
+        : metadata(std::move(metadata)), message(std::move(message)) {}
+#if R_DEFERRED_FORMAT
+    Record(Metadata&& metadata, ArgBuffer&& args)
+        : metadata(std::move(metadata)), args(std::move(args)) {}
+#endif
+    Record(Record&& other) { *this = std::move(other); }
+    Record& operator=(Record&& other) {
+        metadata = std::move(other.metadata);
+        message = std::move(other.message);
+#if R_DEFERRED_FORMAT
+        args = std::move(other.args);
+#endif
+        owned = other.owned;
+        if (owned) {
+            tag = std::move(other.tag);
+            metadata.tag = tag;
+            const char* const before = other.fieldText.data();
+            fields = std::move(other.fields);
+            fieldText = std::move(other.fieldText);
+            for (auto& field : fields) {
+                field.key = moved(field.key, before);
+                field.string = moved(field.string, before);
+            }
+            metadata.fields = Fields(fields.data(), fields.size());
+        }
+        return *this;
+    }
+    /**
+     * @brief Copies what metadata only references, i.e. the tag and
+     *          fields, so that the record can outlive the Log
+     */
+    void own() {
+        // only set while dispatched, as records move
+        metadata.args = nullptr;
+        tag.assign(metadata.tag.begin(), metadata.tag.end());
+        metadata.tag = tag;
+        fields.assign(metadata.fields.begin(), metadata.fields.end());
+        size_t size = 0;
+        for (const auto& field : fields) {
+            size += field.key.size() + field.string.size();
+        }
+        // reserved, so that copies never move
+        fieldText.reserve(size);
+        for (auto& field : fields) {
+            field.key = copy(field.key);
+            field.string = copy(field.string);
+        }
+        metadata.fields = Fields(fields.data(), fields.size());
+        owned = true;
+    }
+    StringRef copy(StringRef value) {
+        const size_t offset = fieldText.size();
+        fieldText.append(value.data(), value.size());
+        return StringRef(fieldText.data() + offset, value.size());
+    }
+    StringRef moved(StringRef value, const char* before) const {
+        return StringRef(fieldText.data() + (value.data() - before),
+                         value.size());
+    }
+    /**
+     * @brief Returns the message, rendering it first if needed
+     * @return const std::string&
+     */
+    const std::string& text() {
+#if R_DEFERRED_FORMAT
+        // args are kept, for sinks that store them as they are
+        if (message.empty() && !args.empty()) {
+            args.render(message);
+        }
+#endif
+        return message;
+    }
+    Metadata metadata;
+    std::string message;
+#if R_DEFERRED_FORMAT
+    ArgBuffer args;
+#endif
+    // storage for metadata.tag and metadata.fields, once owned
+    std::string tag;
+    std::vector<Field> fields;
+    std::string fieldText;
+    bool owned = false;
+};  // Record
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Size used to keep independently written atomics apart,
+ *        so that they do not share a cache line
+ */
+static constexpr size_t cacheLine = 64;
+
+// -----------------------------------------------------------
+
+/**
+ * @brief std::atomic kept on its own cache line, so that writes to
+ *          neighbouring data never invalidate it
+ */
+template <typename T>
+struct alignas(cacheLine) Padded {
+    constexpr Padded(T value) : value(value) {}
+    std::atomic<T> value;
+};  // Padded
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Lock that does nothing, with R_SINGLE_THREADED
+ */
+struct NullLock {
+    void lock() {}
+    bool try_lock() { return true; }
+    void unlock() {}
+};  // NullLock
+
+/**
+ * @brief Test-and-test-and-set spin lock
+ *        Waiters spin on a plain load, so that they do not bounce the
+ *          cache line between them, pausing longer every time, and
+ *          yielding once the lock is held for long
+ */
+struct SpinLock {
+    void lock() {
+        unsigned pauses = 1;
+        while (!try_lock()) {
+            while (locked.load(std::memory_order_relaxed)) {
+                if (pauses > 64) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (unsigned i = 0; i < pauses; ++i) {
+                    pause();
+                }
+                pauses *= 2;
+            }
+        }
+    }
+    bool try_lock() {
+        return !locked.load(std::memory_order_relaxed) &&
+               !locked.exchange(true, std::memory_order_acquire);
+    }
+    void unlock() { locked.store(false, std::memory_order_release); }
+    static void pause() {
+#if R_INTERNAL_X86
+        _mm_pause();
+#endif
+    }
+    std::atomic<bool> locked{false};
+};  // SpinLock
+
+/**
+ * @brief Lock of Serialized Sinks, and of changes to Sinks and levels,
+ *          as selected by R_LOCK & R_SINGLE_THREADED
+ */
+#if R_SINGLE_THREADED
+using Mutex = NullLock;
+#define R_INTERNAL_REENTRANT_LOCK (true)
+#elif R_LOCK == R_LOCK_SPIN
+using Mutex = SpinLock;
+#define R_INTERNAL_REENTRANT_LOCK (false)
+#elif R_LOCK == R_LOCK_MUTEX
+using Mutex = std::mutex;
+#define R_INTERNAL_REENTRANT_LOCK (false)
+#else
+using Mutex = std::recursive_mutex;
+#define R_INTERNAL_REENTRANT_LOCK (true)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Level state read by every log, before anything else
+ *        Static members of a class template, so that all translation
+ *          units share them, while each read needs no guard, unlike a
+ *          function-local static
+ *        Written only by Levels
+ */
+template <typename = void>
+struct LevelCache {
+    // lowest of global and all tag levels, filters the rest of logs
+    static Padded<Level> lowest;
+    // bumped on every level change, invalidating levels cached by sites
+    static Padded<unsigned> changes;
+    // ------------------------------
+    /**
+     * @brief Returns the lowest level a log can have to pass
+     *        Relaxed, since the level guards no other data
+     * @return Level
+     */
+    static Level threshold() {
+        return lowest.value.load(std::memory_order_relaxed);
+    }
+    /**
+     * @brief Returns the number of level changes so far
+     * @return unsigned
+     */
+    static unsigned epoch() {
+        return changes.value.load(std::memory_order_acquire);
+    }
+};  // LevelCache
+
+template <typename T>
+Padded<Level> LevelCache<T>::lowest(Level::Info);
+template <typename T>
+Padded<unsigned> LevelCache<T>::changes(1);
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Matches a text against a glob pattern
+ *        '*' matches any chars, '?' matches a single char
+ * @param pattern: StringRef
+ * @param text: StringRef
+ * @return bool
+ */
+static bool glob(StringRef pattern, StringRef text) {
+    const char* p = pattern.begin();
+    const char* t = text.begin();
+    // last '*' seen, and where in text its match currently ends
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (t != text.end()) {
+        if (p != pattern.end() && (*p == '?' || *p == *t)) {
+            ++p;
+            ++t;
+        } else if (p != pattern.end() && *p == '*') {
+            star = p++;
+            resume = t;
+        } else if (star) {
+            // let the last '*' match one more char
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p != pattern.end() && *p == '*') {
+        ++p;
+    }
+    return p == pattern.end();
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Selection of logging call sites, by filename glob, line range
+ *          and tag glob, along with the state to give them
+ */
+struct SiteRule {
+    std::string file = "*";
+    long first = 0;
+    long last = std::numeric_limits<long>::max();
+    std::string tag = "*";
+    SiteState state = SiteState::ByLevel;
+    // ------------------------------
+    bool matches(const Site& site, StringRef siteTag) const {
+        return site.line >= first && site.line <= last &&
+               glob(file, site.filename) && glob(tag, siteTag);
+    }
+    bool sameSelection(const SiteRule& other) const {
+        return file == other.file && first == other.first &&
+               last == other.last && tag == other.tag;
+    }
+};  // SiteRule
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Singleton that holds run-time levels of RLog
+ *          i.e. global level, levels set per tag, and the registry of
+ *          logging call sites with their states
+ *        Tags are interned in a table, and all accesses are mutex
+ *          protected
+ *        Logs only read LevelCache, and their sites' cached levels
+ */
+struct Levels {
+    /**
+     * @brief Call site, registered on its first log that reaches Check
+     */
+    struct Entry {
+        const Site* site;
+        std::string tag;
+    };
+    // ------------------------------
+    // locks every access to any levels members, and sites' states
+    Mutex mutex;
+    /**/ Level global = Level::Info;
+    /**/ std::map<std::string, Level> tags;
+    /**/ std::vector<Entry> sites;
+    // applied in order, to sites registered later too
+    /**/ std::vector<SiteRule> rules;
+    // ------------------------------
+    /**
+     * @brief getter for levels singleton
+     * @return Levels&
+     */
+    static Levels& instance() {
+        // init of static function locals is threadsafe in c++11
+        static Levels levels;
+        return levels;
+    }
+    /**
+     * @brief Sets global level, and clears all tag levels and site states
+     * @param level: Level
+     */
+    void reset(Level level) {
+        std::lock_guard<Mutex> lock(mutex);
+        global = level;
+        tags.clear();
+        rules.clear();
+        for (auto& entry : sites) {
+            entry.site->state = SiteState::ByLevel;
+        }
+        update();
+    }
+    /**
+     * @brief Sets global level
+     * @param level: Level
+     */
+    void set(Level level) {
+        std::lock_guard<Mutex> lock(mutex);
+        global = level;
+        update();
+    }
+    /**
+     * @brief Sets level of a tag, overriding the global one
+     * @param tag: StringRef
+     * @param level: Level
+     */
+    void set(StringRef tag, Level level) {
+        std::lock_guard<Mutex> lock(mutex);
+        tags[tag.str()] = level;
+        update();
+    }
+    /**
+     * @brief Returns global level
+     * @return Level
+     */
+    Level get() {
+        std::lock_guard<Mutex> lock(mutex);
+        return global;
+    }
+    /**
+     * @brief Returns effective level of a tag
+     * @param tag: StringRef
+     * @return Level, of the tag if set, global otherwise
+     */
+    Level get(StringRef tag) {
+        std::lock_guard<Mutex> lock(mutex);
+        return lookup(tag);
+    }
+    /**
+     * @brief Returns effective level of a tag logged at a call site
+     *        Registers the site on first call
+     * @param site: const Site&
+     * @param tag: StringRef
+     * @return Level, Info for enabled sites and Off for disabled ones
+     */
+    Level get(const Site& site, StringRef tag) {
+        std::lock_guard<Mutex> lock(mutex);
+        if (!site.registered) {
+            enroll(site, tag);
+        }
+        switch (site.state) {
+            case SiteState::Enabled:
+                return Level::Info;
+            case SiteState::Disabled:
+                return Level::Off;
+            default:
+                return lookup(tag);
+        }
+    }
+    /**
+     * @brief Gives matching sites a state, now and when registered later
+     * @param rule: const SiteRule&
+     * @return size_t, number of registered sites matched
+     */
+    size_t apply(const SiteRule& rule) {
+        std::lock_guard<Mutex> lock(mutex);
+        // a newer rule for the same selection replaces the older one
+        rules.erase(std::remove_if(rules.begin(),
+                                   rules.end(),
+                                   [&](const SiteRule& other) {
+                                       return other.sameSelection(rule);
+                                   }),
+                    rules.end());
+        rules.push_back(rule);
+        size_t count = 0;
+        for (auto& entry : sites) {
+            if (rule.matches(*entry.site, entry.tag)) {
+                entry.site->state = rule.state;
+                ++count;
+            }
+        }
+        update();
+        return count;
+    }
+    /**
+     * @brief Describes registered sites matching a rule
+     * @param rule: const SiteRule&, whose state is ignored
+     * @return std::vector<SiteInfo>
+     */
+    std::vector<SiteInfo> list(const SiteRule& rule) {
+        std::lock_guard<Mutex> lock(mutex);
+        std::vector<SiteInfo> result;
+        for (const auto& entry : sites) {
+            const Site& site = *entry.site;
+            if (rule.matches(site, entry.tag)) {
+                result.push_back(
+                    {site.filename, site.line, site.level, entry.tag,
+                     site.state});
+            }
+        }
+        return result;
+    }
+    /**
+     * @brief Returns effective level of a tag logged at a call site
+     *        Cached on the site along with the epoch it was resolved at,
+     *          so that it is only looked up again after a level change
+     *        The cache is keyed on the address of the tag, so it is only
+     *          used for const char arrays, i.e. string literals, whose
+     *          content never changes
+     *        A site logging different arrays only caches the first one
+     *          there, the others are cached per thread by content
+     * @param site: const Site&
+     * @param tag: const char*
+     * @return Level
+     */
+    static Level resolve(const Site& site, const char* tag) {
+        const unsigned epoch = LevelCache<>::epoch();
+        // level is stored plus one, so that an empty cache never matches
+        if (site.cachedTag.load(std::memory_order_relaxed) == tag) {
+            const unsigned cached =
+                site.cachedLevel.load(std::memory_order_relaxed);
+            if ((cached & ~0xffu) == (epoch << 8)) {
+                return static_cast<Level>((cached & 0xffu) - 1);
+            }
+        }
+        return refresh(site, tag, epoch);
+    }
+    /**
+     * @brief Returns effective level of a tag given at run time, e.g. an
+     *          std::string, logged at a call site
+     *        Cached by the calling thread, by site and tag content, along
+     *          with the epoch it was resolved at, so that the levels are
+     *          only locked again after a level change, or a cache miss
+     * @param site: const Site&
+     * @param tag: StringRef
+     * @return Level
+     */
+    static Level resolve(const Site& site, StringRef tag) {
+        struct Cached {
+            const Site* site = nullptr;
+            unsigned epoch = 0;
+            Level level = Level::Info;
+            std::string tag;
+        };
+        static thread_local Cached cache[64];
+        const unsigned epoch = LevelCache<>::epoch();
+        // FNV-1a of the tag, seeded with the site
+        size_t hash = reinterpret_cast<size_t>(&site) >> 4;
+        for (const char c : tag) {
+            hash = (hash ^ static_cast<unsigned char>(c)) *
+                   static_cast<size_t>(1099511628211ull);
+        }
+        Cached& cached = cache[(hash ^ (hash >> 16)) & 63];
+        if (cached.site == &site && cached.epoch == epoch &&
+            StringRef(cached.tag) == tag) {
+            return cached.level;
+        }
+        cached.level = instance().get(site, tag);
+        cached.site = &site;
+        cached.epoch = epoch;
+        // keeps its capacity, so misses seldom allocate
+        cached.tag.assign(tag.data(), tag.size());
+        return cached.level;
+    }
+    /**
+     * @brief Looks up effective level of a tag, and caches it on the site
+     *        Kept apart from resolve, so that its cheap path gets inlined
+     * @param site: const Site&
+     * @param tag: const char*
+     * @param epoch: unsigned, read before the look up
+     * @return Level
+     */
+    static Level refresh(const Site& site, const char* tag, unsigned epoch) {
+        const char* expected = nullptr;
+        if (!site.cachedTag.compare_exchange_strong(expected, tag) &&
+            expected != tag) {
+            // taken by another array, which would never be cached again
+            return resolve(site, StringRef(tag));
+        }
+        const Level level = instance().get(site, tag ? tag : "");
+        site.cachedLevel.store((epoch << 8) | (level + 1),
+                               std::memory_order_relaxed);
+        return level;
+    }
+    // ------------------------------
+    /**
+     * @brief Returns effective level of a tag
+     *        Called with mutex locked
+     */
+    Level lookup(StringRef tag) const {
+        if (tags.empty()) {
+            return global;
+        }
+        const auto it = tags.find(tag.str());
+        return it == tags.end() ? global : it->second;
+    }
+    /**
+     * @brief Adds a site to the registry, applying existing rules to it
+     *        Called with mutex locked
+     */
+    void enroll(const Site& site, StringRef tag) {
+        site.registered = true;
+        sites.push_back({&site, tag.str()});
+        for (const auto& rule : rules) {
+            if (rule.matches(site, tag)) {
+                site.state = rule.state;
+            }
+        }
+    }
+    /**
+     * @brief Publishes a level change to LevelCache
+     *        Called with mutex locked
+     */
+    void update() {
+        Level lowest = global;
+        for (const auto& tag : tags) {
+            lowest = std::min(lowest, tag.second);
+        }
+        // sites to enable may be below every level, and need to reach Check
+        for (const auto& rule : rules) {
+            if (rule.state == SiteState::Enabled) {
+                lowest = Level::Info;
+            }
+        }
+        LevelCache<>::lowest.value.store(lowest, std::memory_order_relaxed);
+        LevelCache<>::changes.value.fetch_add(1, std::memory_order_release);
+    }
+};  // Levels
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Run-time filtering of a log made by a logging macro, by the
+ *          effective level of its tag
+ *        Converts to true when the log is filtered out, so that it fits
+ *          the if / else chain of R_INTERNAL_LOG
+ *        Carries the site and the tag on to the Log, so that the tag
+ *          expression is only evaluated once
+ *        Lives in the condition of an if statement, which outlives any
+ *          temporary the tag is made of, so that other than string
+ *          literals, tags of logs that pass are copied
+ */
+struct Check {
+    template <size_t N>
+    Check(const Site& site, const char (&tag)[N])
+        : site(site), filtered(site.level < Levels::resolve(site, tag)) {
+        if (!filtered) {
+            this->tag = StringRef(tag);
+        }
+    }
+    // a char array may be reused with other content, so it is no literal
+    template <size_t N>
+    Check(const Site& site, char (&tag)[N])
+        : Check(site, static_cast<const char*>(tag)) {}
+    template <typename T>
+    Check(const Site& site, const T& tag) : site(site) {
+        const StringRef ref(tag);
+        filtered = site.level < Levels::resolve(site, ref);
+        if (!filtered) {
+            owned.assign(ref.data(), ref.size());
+            this->tag = owned;
+        }
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(Check);
+    explicit operator bool() const { return filtered; }
+    const Site& site;
+    StringRef tag;
+    std::string owned;
+    bool filtered;
+};  // Check
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Bounded lock-free multi-producer/single-consumer queue of Records
+ *        Every cell carries a sequence number telling producers and the
+ *          consumer whose turn it is, so no lock is ever taken
+ * @note Capacity must be a power of two
+ */
+struct MpscRing {
+    explicit MpscRing(size_t capacity)
+        : mask(capacity - 1), cells(new Cell[capacity]) {
+        assert(capacity >= 2 && (capacity & mask) == 0);
+        for (size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(MpscRing);
+    /**
+     * @brief Moves a record into the queue, from any thread
+     * @return false if the queue is full, record is then left untouched
+     */
+    bool tryPush(Record& record) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) -
+                              static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.record = std::move(record);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    /**
+     * @brief Moves the oldest record out of the queue
+     * @note Must only be called from the single consumer thread
+     * @return false if the queue is empty
+     */
+    bool tryPop(Record& record) {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        Cell& cell = cells[pos & mask];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != pos + 1) {
+            return false;
+        }
+        record = std::move(cell.record);
+        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+        head.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief Number of records claimed by producers so far
+     */
+    size_t pushed() const { return tail.load(std::memory_order_acquire); }
+    /**
+     * @brief Number of records taken by the consumer so far
+     */
+    size_t popped() const { return head.load(std::memory_order_acquire); }
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    char pad0[cacheLine];
+    // written by producers
+    std::atomic<size_t> tail{0};
+    char pad1[cacheLine];
+    // written by the consumer
+    std::atomic<size_t> head{0};
+    char pad2[cacheLine];
+};  // MpscRing
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A global Sink, called as its SinkPolicy says
+ *        Serialized: under a Mutex of its own, which the Sink can log
+ *          itself under, as the thread holding it calls it directly
+ *        Confined: by a worker thread of its own, draining a queue of
+ *          owned Records like the async backend
+ */
+struct SinkEntry {
+    /**
+     * @brief Number of Sinks the calling thread is in, i.e. nested logs of
+     *          a Sink, counting the worker of a Confined Sink calling it
+     * @return int&
+     */
+    static int& depth() {
+        static thread_local int depth = 0;
+        return depth;
+    }
+    /**
+     * @brief Worker thread state of a Confined Sink
+     *        Shared with the thread, so that it outlives an entry freed by
+     *          the Sink itself, whose thread is then left to stop alone
+     */
+    struct Worker {
+        explicit Worker(const Sink& sink)
+            : sink(sink), ring(R_ASYNC_CAPACITY) {}
+        R_INTERNAL_DISALLOW_COPY_ASSIGN(Worker);
+        bool onWorker() const {
+            // only ever equal if written by this very thread
+            return id.load(std::memory_order_relaxed) ==
+                   std::this_thread::get_id();
+        }
+        void run() {
+            // before the first log, which the Sink may log in
+            id.store(std::this_thread::get_id(), std::memory_order_relaxed);
+            Record record;
+            unsigned idle = 0;
+            for (;;) {
+                if (ring.tryPop(record)) {
+                    // counted as in a Sink, so that reset by the Sink does
+                    // not wait for logs, that may be waiting on this thread
+                    ++depth();
+                    sink(record.metadata, record.text());
+                    --depth();
+                    processed.store(ring.popped(), std::memory_order_release);
+                    idle = 0;
+                } else if (stopping.load(std::memory_order_acquire)) {
+                    // loggers are gone, so an empty queue stays empty
+                    break;
+                } else if (++idle < 64) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(100));
+                }
+            }
+        }
+        const Sink sink;
+        MpscRing ring;
+        std::atomic<size_t> processed{0};
+        std::atomic<bool> stopping{false};
+        std::atomic<std::thread::id> id{std::thread::id()};
+    };  // Worker
+    // ------------------------------
+    SinkEntry(const Sink& sink, SinkPolicy policy)
+        : sink(policy == SinkPolicy::Confined ? Sink() : sink),
+          policy(policy) {
+        if (policy == SinkPolicy::Confined) {
+            assert(!R_SINGLE_THREADED);
+            worker = std::make_shared<Worker>(sink);
+            const std::shared_ptr<Worker> state = worker;
+            thread = std::thread([state] { state->run(); });
+        }
+    }
+    /**
+     * @brief Passes logs still queued to a Confined Sink, then stops it
+     *        Only called once no log can be reading the entry, i.e. when
+     *          the last Sinks holding it are freed
+     *        Freed by the Sink itself, its thread cannot be joined, and
+     *          stops on its own once the Sink returns
+     */
+    ~SinkEntry() {
+        if (thread.joinable()) {
+            worker->stopping.store(true, std::memory_order_release);
+            if (worker->onWorker()) {
+                thread.detach();
+            } else {
+                thread.join();
+            }
+        }
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(SinkEntry);
+    void operator()(const Metadata& metadata, const std::string& message) {
+        switch (policy) {
+            case SinkPolicy::Serialized:
+                serialized(metadata, message);
+                break;
+            case SinkPolicy::ThreadSafe:
+                sink(metadata, message);
+                break;
+            case SinkPolicy::Confined: {
+                if (worker->onWorker()) {
+                    // logs of the Sink itself, waiting would wait on itself
+                    worker->sink(metadata, message);
+                    break;
+                }
+                Record record{Metadata(metadata), std::string(message)};
+                record.own();
+                // never drop, wait for the worker to make room
+                while (!worker->ring.tryPush(record)) {
+                    std::this_thread::yield();
+                }
+                break;
+            }
+        }
+    }
+#if R_INTERNAL_REENTRANT_LOCK
+    void serialized(const Metadata& metadata, const std::string& message) {
+        std::lock_guard<Mutex> lock(mutex);
+        sink(metadata, message);
+    }
+#else
+    void serialized(const Metadata& metadata, const std::string& message) {
+        const std::thread::id self = std::this_thread::get_id();
+        // only ever equal if written by this very thread
+        if (owner.load(std::memory_order_relaxed) == self) {
+            sink(metadata, message);
+            return;
+        }
+        std::lock_guard<Mutex> lock(mutex);
+        const Owner owned(owner, self);
+        sink(metadata, message);
+    }
+    /**
+     * @brief Marks the thread holding mutex, while in scope
+     */
+    struct Owner {
+        Owner(std::atomic<std::thread::id>& owner, std::thread::id self)
+            : owner(owner) {
+            owner.store(self, std::memory_order_relaxed);
+        }
+        R_INTERNAL_DISALLOW_COPY_ASSIGN(Owner);
+        ~Owner() {
+            owner.store(std::thread::id(), std::memory_order_relaxed);
+        }
+        std::atomic<std::thread::id>& owner;
+    };  // Owner
+#endif
+    /**
+     * @brief Blocks until logs queued so far to a Confined Sink are passed
+     */
+    void flush() {
+        if (!worker || worker->onWorker()) {
+            return;
+        }
+        const size_t target = worker->ring.pushed();
+        while (worker->processed.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+    const Sink sink;
+    const SinkPolicy policy;
+    // SinkPolicy::Serialized state
+    Mutex mutex;
+#if !R_INTERNAL_REENTRANT_LOCK
+    std::atomic<std::thread::id> owner{std::thread::id()};
+#endif
+    // SinkPolicy::Confined state
+    std::shared_ptr<Worker> worker;
+    std::thread thread;
+};  // SinkEntry
+
+/**
+ * @brief Global Sinks, as seen by a log
+ *        Never modified once published, only replaced as a whole
+ */
+using Sinks = std::vector<std::shared_ptr<SinkEntry>>;
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Singleton that holds global Sinks of RLog
+ *        Logs read the current Sinks without a lock, while addSink &
+ *          reset publish new ones, i.e. read-copy-update
+ *        Replaced Sinks are only freed once no log can be reading them,
+ *          i.e. once the epoch moved on twice since, which addSink tries
+ *          without waiting, and reset waits for, as it also makes sure
+ *          that removed Sinks are no longer called after it returns
+ */
+struct Store {
+    Store() {}
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(Store);
+    // ------------------------------
+    /**
+     * @brief Number of logs reading Sinks, on a cache line of its own
+     */
+    struct Readers {
+        std::atomic<unsigned> count{0};
+        char pad[cacheLine - sizeof(std::atomic<unsigned>)];
+    };
+    /**
+     * @brief Replaced Sinks, and the epoch they were replaced in
+     */
+    struct Retired {
+        unsigned epoch;
+        std::unique_ptr<const Sinks> sinks;
+    };
+    // ------------------------------
+    // Sinks read by logs
+    std::unique_ptr<const Sinks> owned{new Sinks()};
+    std::atomic<const Sinks*> current{owned.get()};
+    char pad0[cacheLine];
+    // logs reading Sinks, by the parity of the epoch they started in
+    Readers readers[2];
+    // only moved on with mutex locked
+    std::atomic<unsigned> epoch{0};
+    // serializes writers, and guards owned, retired & epoch
+    Mutex mutex;
+    // replaced Sinks, that logs might still be reading
+    std::vector<Retired> retired;
+    // ------------------------------
+    /**
+     * @brief getter for store singleton
+     * @return Store&
+     */
+    static Store& instance() {
+        // init of static function locals is threadsafe in c++11
+        static Store store;
+        return store;
+    }
+    /**
+     * @brief Holds current Sinks for the duration of a log
+     */
+    struct Reader {
+#if R_SINGLE_THREADED
+        // no other thread can be replacing Sinks
+        explicit Reader(Store& store)
+            : store(store), index(0), sinks(store.current.load()) {
+            ++SinkEntry::depth();
+        }
+        ~Reader() { --SinkEntry::depth(); }
+#else
+        explicit Reader(Store& store)
+            : store(store),
+              index(store.epoch.load(std::memory_order_relaxed) & 1) {
+            // reads what a writer found no readers after, see drained
+            store.readers[index].count.fetch_add(1,
+                                                 std::memory_order_acquire);
+            ++SinkEntry::depth();
+            sinks = store.current.load(std::memory_order_acquire);
+        }
+        ~Reader() {
+            --SinkEntry::depth();
+            store.readers[index].count.fetch_sub(1,
+                                                 std::memory_order_release);
+        }
+#endif
+        R_INTERNAL_DISALLOW_COPY_ASSIGN(Reader);
+        Store& store;
+        const unsigned index;
+        const Sinks* sinks;
+    };  // Reader
+    // ------------------------------
+    /**
+     * @brief Passes a log to all the active Sinks
+     *        Used by both synchronous logs and the async backend
+     *        The message is only rendered if there is any Sink
+     * @param record: Record&
+     */
+    void dispatch(Record& record) {
+        const Reader reader(*this);
+        if (reader.sinks->empty()) {
+            return;
+        }
+#if R_DEFERRED_FORMAT
+        record.metadata.args = &record.args;
+#endif
+        send(*reader.sinks, record.metadata, record.text());
+    }
+    /**
+     * @brief Passes a log to all the active Sinks
+     * @param metadata: const Metadata&
+     * @param message: const std::string&
+     */
+    void dispatch(const Metadata& metadata, const std::string& message) {
+        const Reader reader(*this);
+        send(*reader.sinks, metadata, message);
+    }
+    static void send(const Sinks& sinks,
+                     const Metadata& metadata,
+                     const std::string& message) {
+        for (const auto& sink : sinks) {
+            (*sink)(metadata, message);
+        }
+    }
+    // ------------------------------
+    /**
+     * @brief Blocks until logs queued so far to Confined Sinks are passed
+     */
+    void flush() {
+        Sinks sinks;
+        {
+            const Reader reader(*this);
+            sinks = *reader.sinks;
+        }
+        // not waited on as a reader, as the Sinks might reset
+        for (const auto& sink : sinks) {
+            sink->flush();
+        }
+    }
+    /**
+     * @brief Publishes current Sinks with one more
+     *        Does not wait for logs reading the replaced ones, but frees
+     *          those no log can be reading anymore
+     * @param sink: const Sink&
+     * @param policy: SinkPolicy
+     */
+    void add(const Sink& sink, SinkPolicy policy) {
+        std::vector<Retired> freed;
+        {
+            std::lock_guard<Mutex> lock(mutex);
+            Sinks sinks(*owned);
+            sinks.push_back(std::make_shared<SinkEntry>(sink, policy));
+            publish(std::move(sinks));
+            if (advance()) {
+                advance();
+            }
+            const unsigned now = epoch.load(std::memory_order_relaxed);
+            size_t kept = 0;
+            for (Retired& old : retired) {
+                if (now - old.epoch < 2) {
+                    retired[kept++] = std::move(old);
+                } else {
+                    freed.push_back(std::move(old));
+                }
+            }
+            retired.erase(retired.begin() + kept, retired.end());
+        }
+        // freed unlocked, as stopping a Confined Sink waits for its worker
+    }
+    /**
+     * @brief Publishes no Sinks, and waits for logs still reading the
+     *          replaced ones, unless called by a Sink
+     */
+    void clear() {
+        std::vector<Retired> replaced;
+        {
+            std::lock_guard<Mutex> lock(mutex);
+            publish(Sinks());
+            if (SinkEntry::depth() > 0) {
+                return;
+            }
+            replaced.swap(retired);
+        }
+        // unlocked, so that Sinks still being called can add Sinks
+        synchronize();
+    }
+    void publish(Sinks&& sinks) {
+        std::unique_ptr<const Sinks> next(new Sinks(std::move(sinks)));
+        current.store(next.get(), std::memory_order_release);
+        retired.push_back(
+            {epoch.load(std::memory_order_relaxed), std::move(owned)});
+        owned = std::move(next);
+    }
+    /**
+     * @brief Whether no log is reading Sinks with given parity
+     *        Confirmed by a read-modify-write, that a log counted later
+     *          acquires, so that it reads Sinks published before
+     * @param parity: unsigned
+     * @return bool
+     */
+    bool drained(unsigned parity) {
+#if R_SINGLE_THREADED
+        // the only log there can be is one of the calling thread
+        (void)parity;
+        return SinkEntry::depth() == 0;
+#else
+        std::atomic<unsigned>& count = readers[parity].count;
+        return count.load(std::memory_order_acquire) == 0 &&
+               count.fetch_add(0, std::memory_order_acq_rel) == 0;
+#endif
+    }
+    /**
+     * @brief Moves the epoch on, unless logs that started two epochs ago
+     *          are still reading Sinks, whose parity new logs take next
+     *        Sinks replaced in an epoch are freed once it moved on twice,
+     *          as logs of either parity might be reading them
+     * @note Must be called with mutex locked
+     * @return false if it could not
+     */
+    bool advance() {
+        const unsigned now = epoch.load(std::memory_order_relaxed);
+        if (!drained((now + 1) & 1)) {
+            return false;
+        }
+        epoch.store(now + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief Waits until logs that might have read replaced Sinks are done
+     */
+    void synchronize() {
+        std::unique_lock<Mutex> lock(mutex);
+        const unsigned start = epoch.load(std::memory_order_relaxed);
+        while (epoch.load(std::memory_order_relaxed) - start < 2) {
+            if (!advance()) {
+                // unlocked meanwhile, so that Sinks being called can add
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+            }
+        }
+    }
+};  // Store
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer queue of Records
+ *        Each side caches the other's index, so the shared cache lines
+ *          are only touched when the cached view runs out
+ * @note Capacity must be a power of two
+ */
+struct SpscRing {
+    explicit SpscRing(size_t capacity)
+        : mask(capacity - 1), records(new Record[capacity]) {
+        assert(capacity >= 2 && (capacity & mask) == 0);
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(SpscRing);
+    /**
+     * @brief Moves a record into the queue
+     * @note Must only be called from the single producer thread
+     * @return false if the queue is full, record is then left untouched
+     */
+    bool tryPush(Record& record) {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        if (pos - headCache > mask) {
+            headCache = head.load(std::memory_order_acquire);
+            if (pos - headCache > mask) {
+                return false;
+            }
+        }
+        records[pos & mask] = std::move(record);
+        tail.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief Oldest record in the queue, left in place
+     * @note Must only be called from the single consumer thread
+     * @return nullptr if the queue is empty
+     */
+    Record* front() {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        if (pos == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (pos == tailCache) {
+                return nullptr;
+            }
+        }
+        return &records[pos & mask];
+    }
+    /**
+     * @brief Releases the record returned by front()
+     * @note Must only be called from the single consumer thread
+     */
+    void pop() {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        records[pos & mask] = Record();
+        head.store(pos + 1, std::memory_order_release);
+    }
+    /**
+     * @brief Number of records pushed so far
+     */
+    size_t pushed() const { return tail.load(std::memory_order_acquire); }
+    /**
+     * @brief Number of records popped so far
+     */
+    size_t popped() const { return head.load(std::memory_order_acquire); }
+
+    const size_t mask;
+    std::unique_ptr<Record[]> records;
+    char pad0[cacheLine];
+    // producer side
+    std::atomic<size_t> tail{0};
+    size_t headCache = 0;
+    char pad1[cacheLine];
+    // consumer side
+    std::atomic<size_t> head{0};
+    size_t tailCache = 0;
+    char pad2[cacheLine];
+};  // SpscRing
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Queue owned by a single logging thread in per-thread async mode
+ *        Shared between its thread and the backend, freed by whichever
+ *          lets go last
+ */
+struct ThreadBuffer {
+    explicit ThreadBuffer(size_t capacity) : ring(capacity) {}
+    SpscRing ring;
+    // set by the owner around a push, so that stop can wait for it
+    std::atomic<bool> writing{false};
+    // set once the owner thread has exited
+    std::atomic<bool> retired{false};
+    // records fully passed to the Sinks
+    std::atomic<size_t> processed{0};
+};  // ThreadBuffer
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Thread-local link to the calling thread's ThreadBuffer
+ *        Hands the buffer back to the backend when the thread exits
+ */
+struct ThreadBufferHandle {
+    ThreadBufferHandle() {}
+    ~ThreadBufferHandle() {
+        if (buffer) {
+            buffer->retired.store(true, std::memory_order_release);
+        }
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(ThreadBufferHandle);
+    std::shared_ptr<ThreadBuffer> buffer;
+    // backend session the buffer was registered with
+    size_t session = 0;
+};  // ThreadBufferHandle
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Singleton that owns the async logging backend
+ *          i.e. the queues and the thread that drains them into the Sinks
+ *        When active, Logs only enqueue themselves
+ *        In AsyncMode::Shared, all threads push into one MpscRing
+ *        In AsyncMode::PerThread, every thread lazily registers its own
+ *          ThreadBuffer, and the backend merges them in order of ticks
+ */
+struct AsyncBackend {
+    // serializes start, stop and flush
+    std::mutex mutex;
+    std::atomic<bool> active{false};
+    std::atomic<bool> stopping{false};
+    // written only while inactive, so only relied upon by producers
+    // registered before their active check, that the thread waits for
+    std::atomic<AsyncMode> mode{AsyncMode::Shared};
+    std::atomic<size_t> capacity{0};
+    // incremented by start, before active is set
+    std::atomic<size_t> session{0};
+    // ------------------------------
+    // AsyncMode::Shared state
+    // producers currently between their active check and their push
+    std::atomic<size_t> producers{0};
+    // records fully passed to the Sinks
+    std::atomic<size_t> processed{0};
+    std::unique_ptr<MpscRing> ring;
+    // ------------------------------
+    // AsyncMode::PerThread state
+    // locks every access to buffers
+    std::mutex registryMutex;
+    /**/ std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    /**/ size_t registryVersion = 0;
+    // worker's copy of buffers, refreshed only when registryVersion changed
+    std::vector<std::shared_ptr<ThreadBuffer>> local;
+    size_t localVersion = 0;
+    // ------------------------------
+    std::thread worker;
+    // ------------------------------
+    AsyncBackend() {
+        // make sure Store is destroyed after the backend
+        Store::instance();
+    }
+    ~AsyncBackend() { stop(); }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(AsyncBackend);
+    /**
+     * @brief getter for backend singleton
+     * @return AsyncBackend&
+     */
+    static AsyncBackend& instance() {
+        static AsyncBackend backend;
+        return backend;
+    }
+    /**
+     * @brief true on the backend's own thread
+     *        Logs made from inside Sinks there are dispatched synchronously,
+     *          since waiting on a full queue would wait on itself
+     */
+    static bool& onWorker() {
+        static thread_local bool flag = false;
+        return flag;
+    }
+    /**
+     * @brief getter for the calling thread's buffer handle
+     */
+    static ThreadBufferHandle& threadBuffer() {
+        static thread_local ThreadBufferHandle handle;
+        return handle;
+    }
+    /**
+     * @brief Enqueues a record if async mode is active
+     * @param make: callable returning the Record, only called if accepted
+     * @return false if the caller should dispatch synchronously instead
+     */
+    template <typename MakeRecord>
+    bool push(MakeRecord make) {
+        if (!active.load(std::memory_order_acquire) || onWorker()) {
+            return false;
+        }
+        // a guess, as a restart might change it before registering
+        return mode.load(std::memory_order_relaxed) == AsyncMode::PerThread
+                   ? pushLocal(make)
+                   : pushShared(make);
+    }
+    template <typename MakeRecord>
+    bool pushShared(MakeRecord make) {
+        producers.fetch_add(1);
+        const bool accepted = active.load();
+        if (accepted) {
+            if (mode.load() != AsyncMode::Shared) {
+                // restarted per-thread since the guess, so there is no ring
+                producers.fetch_sub(1);
+                return pushLocal(make);
+            }
+            assert(ring);
+            Record record = make();
+            // never drop, wait for the backend to make room
+            while (!ring->tryPush(record)) {
+                std::this_thread::yield();
+            }
+        }
+        producers.fetch_sub(1);
+        return accepted;
+    }
+    template <typename MakeRecord>
+    bool pushLocal(MakeRecord make) {
+        ThreadBufferHandle& handle = threadBuffer();
+        for (;;) {
+            const size_t current = session.load(std::memory_order_acquire);
+            if (handle.session != current) {
+                // first log of this thread in this session
+                if (handle.buffer) {
+                    handle.buffer->retired.store(true,
+                                                 std::memory_order_release);
+                }
+                handle.buffer =
+                    std::make_shared<ThreadBuffer>(capacity.load());
+                handle.session = current;
+                std::lock_guard<std::mutex> lock(registryMutex);
+                buffers.push_back(handle.buffer);
+                ++registryVersion;
+            }
+            ThreadBuffer& buffer = *handle.buffer;
+            buffer.writing.store(true);
+            if (!active.load()) {
+                buffer.writing.store(false, std::memory_order_release);
+                return false;
+            }
+            // restarted since the session was read, so the new backend
+            // would never drain buffer, register again
+            if (session.load() != current) {
+                buffer.writing.store(false, std::memory_order_release);
+                continue;
+            }
+            if (mode.load() != AsyncMode::PerThread) {
+                // restarted shared since the guess, which never drains buffer
+                buffer.writing.store(false, std::memory_order_release);
+                return pushShared(make);
+            }
+            Record record = make();
+            // never drop, wait for the backend to make room
+            while (!buffer.ring.tryPush(record)) {
+                std::this_thread::yield();
+            }
+            buffer.writing.store(false, std::memory_order_release);
+            return true;
+        }
+    }
+    /**
+     * @brief Starts the backend thread, if not already running
+     * @param mode: queueing strategy
+     * @param capacity: size of each queue, a power of two
+     */
+    void start(AsyncMode mode, size_t capacity) {
+        assert(!R_SINGLE_THREADED);
+        // a Sink that stopped async mode cannot wait on its own thread
+        if (onWorker()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (active) {
+            return;
+        }
+        // stopped by a Sink, so the previous thread might still be draining
+        join();
+        this->mode = mode;
+        this->capacity = capacity;
+        ++session;
+        if (mode == AsyncMode::Shared) {
+            ring.reset(new MpscRing(capacity));
+            processed = 0;
+        }
+        stopping = false;
+        worker = std::thread([this] { run(); });
+        active = true;
+    }
+    /**
+     * @brief Stops accepting records, drains the queues and joins the thread
+     *        Called by a Sink, only stops accepting records, the thread
+     *          then drains and exits by itself, and is joined by the next
+     *          call from another thread
+     */
+    void stop() {
+        if (onWorker()) {
+            // not locked, as flush might hold mutex, waiting on this thread
+            if (active.exchange(false)) {
+                stopping = true;
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (active) {
+            active = false;
+            stopping = true;
+        }
+        join();
+    }
+    /**
+     * @brief Joins the thread once it is stopping, and drops the queues
+     * @note Must be called with mutex locked
+     */
+    void join() {
+        if (!worker.joinable()) {
+            return;
+        }
+        worker.join();
+        ring.reset();
+        local.clear();
+        std::lock_guard<std::mutex> registryLock(registryMutex);
+        buffers.clear();
+        localVersion = ++registryVersion;
+    }
+    /**
+     * @brief Whether no producer that saw active can still push
+     *        Any producer counted or writing later sees active is false,
+     *          as it checks after
+     * @note Must only be called once stopping
+     */
+    bool quiet() {
+        if (producers.load() != 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& buffer : buffers) {
+            if (buffer->writing.load()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    /**
+     * @brief Blocks until every record enqueued before the call
+     *          has been passed to the Sinks
+     */
+    void flush() {
+        if (onWorker()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!active) {
+            // stopped by a Sink, the thread drains what is left
+            join();
+            return;
+        }
+        if (mode.load() == AsyncMode::Shared) {
+            const size_t target = ring->pushed();
+            while (processed.load(std::memory_order_acquire) < target) {
+                std::this_thread::yield();
+            }
+            return;
+        }
+        std::vector<std::pair<std::shared_ptr<ThreadBuffer>, size_t>> targets;
+        {
+            std::lock_guard<std::mutex> registryLock(registryMutex);
+            for (auto& buffer : buffers) {
+                targets.emplace_back(buffer, buffer->ring.pushed());
+            }
+        }
+        for (auto& target : targets) {
+            while (target.first->processed.load(std::memory_order_acquire) <
+                   target.second) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    /**
+     * @brief Body of the backend thread
+     */
+    void run() {
+        onWorker() = true;
+        unsigned idle = 0;
+        for (;;) {
+            // checked before draining, as producers may push until quiet
+            const bool last = stopping.load() && quiet();
+            const size_t drained =
+                mode.load(std::memory_order_relaxed) == AsyncMode::Shared
+                ? drainShared()
+                : drainLocal();
+            if (drained != 0) {
+                idle = 0;
+            } else if (last) {
+                // producers are gone, so empty queues stay empty
+                break;
+            } else if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+    /**
+     * @brief Passes all currently queued records of the MpscRing to the Sinks
+     * @return number of records passed
+     */
+    size_t drainShared() {
+        Record record;
+        size_t count = 0;
+        while (ring->tryPop(record)) {
+            Store::instance().dispatch(record);
+            processed.store(ring->popped(), std::memory_order_release);
+            ++count;
+        }
+        return count;
+    }
+    /**
+     * @brief Passes all currently queued records of all ThreadBuffers to
+     *          the Sinks, oldest first
+     *        Drops buffers of exited threads once they are empty
+     * @return number of records passed
+     */
+    size_t drainLocal() {
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            if (localVersion != registryVersion) {
+                local = buffers;
+                localVersion = registryVersion;
+            }
+        }
+        size_t count = 0;
+        for (;;) {
+            ThreadBuffer* oldest = nullptr;
+            Record* oldestRecord = nullptr;
+            for (auto& buffer : local) {
+                Record* record = buffer->ring.front();
+                if (record &&
+                    (!oldestRecord ||
+                     record->metadata.ticks < oldestRecord->metadata.ticks)) {
+                    oldest = buffer.get();
+                    oldestRecord = record;
+                }
+            }
+            if (!oldest) {
+                break;
+            }
+            Store::instance().dispatch(*oldestRecord);
+            oldest->ring.pop();
+            oldest->processed.store(oldest->ring.popped(),
+                                    std::memory_order_release);
+            ++count;
+        }
+        for (auto& buffer : local) {
+            // retired is published after the owner's last push
+            if (buffer->retired.load(std::memory_order_acquire) &&
+                !buffer->ring.front()) {
+                retire(buffer);
+            }
+        }
+        return count;
+    }
+    /**
+     * @brief Removes a buffer from the registry
+     */
+    void retire(const std::shared_ptr<ThreadBuffer>& buffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto it = buffers.begin(); it != buffers.end(); ++it) {
+            if (*it == buffer) {
+                buffers.erase(it);
+                ++registryVersion;
+                return;
+            }
+        }
+    }
+};  // AsyncBackend
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Inits / resets all global state of RLog
+ *        Sets level to specified
+ *        Stops async mode, after passing pending logs to the Sinks
+ *        Clears all existing global Sinks
+ *        Best called atleast once from a single-threaded init context
+ * @param global level. default: Info
+ */
+static void reset(Level level = Level::Info) {
+    internal::AsyncBackend::instance().stop();
+    internal::Levels::instance().reset(level);
+    internal::Store::instance().clear();
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Adds a new global Sink
+ *        Different Sinks never contend with each other, whatever policy
+ * @param sink: copyable Sink instance
+ * @param policy: SinkPolicy. default: Serialized
+ */
+static void addSink(const Sink& sink,
+                    SinkPolicy policy = SinkPolicy::Serialized) {
+    internal::Store::instance().add(sink, policy);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Switches to async mode
+ *        Logs are then only enqueued by the calling thread, and a
+ *          dedicated backend thread passes them to the Sinks
+ *        Does nothing if already in async mode
+ * @param capacity: max pending logs, a power of two.
+ *                  default: R_ASYNC_CAPACITY
+ */
+static void startAsync(size_t capacity = R_ASYNC_CAPACITY) {
+    internal::AsyncBackend::instance().start(AsyncMode::Shared, capacity);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Switches to async mode, with specified queueing strategy
+ *        Does nothing if already in async mode
+ * @param mode: AsyncMode
+ * @param capacity: max pending logs per queue, a power of two.
+ *                  default: R_ASYNC_CAPACITY for AsyncMode::Shared,
+ *                           R_ASYNC_THREAD_CAPACITY for AsyncMode::PerThread
+ */
+static void startAsync(AsyncMode mode, size_t capacity = 0) {
+    if (capacity == 0) {
+        capacity = mode == AsyncMode::Shared ? R_ASYNC_CAPACITY
+                                             : R_ASYNC_THREAD_CAPACITY;
+    }
+    internal::AsyncBackend::instance().start(mode, capacity);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Leaves async mode
+ *        Pending logs are passed to the Sinks before returning
+ */
+static void stopAsync() { internal::AsyncBackend::instance().stop(); }
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Blocks until all logs made so far have been passed to the Sinks
+ *        Logs are only pending in async mode, and for Confined Sinks
+ */
+static void flush() {
+    internal::AsyncBackend::instance().flush();
+    internal::Store::instance().flush();
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Returns global level
+ * @return Level
+ */
+static inline Level level() { return internal::Levels::instance().get(); }
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Returns effective level of specified tag
+ * @param tag: StringRef
+ * @return Level, of the tag if set, global level otherwise
+ */
+static inline Level level(StringRef tag) {
+    return internal::Levels::instance().get(tag);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Sets global level, keeping Sinks and tag levels
+ * @param level: Level
+ */
+static void setLevel(Level level) { internal::Levels::instance().set(level); }
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Sets level of specified tag, overriding global level for its
+ *          logs, whether it is lower or higher
+ *        Cleared by reset
+ * @param tag: StringRef
+ * @param level: Level
+ */
+static void setLevel(StringRef tag, Level level) {
+    internal::Levels::instance().set(tag, level);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Selection of logging call sites, to enable / disable at run-time
+ *        Sites are registered on their first log that passes the global
+ *          and tag levels, or any log while some sites are enabled
+ *        Selected by filename glob, line range and tag glob, all of which
+ *          default to any
+ *        Enabling, disabling or restoring also applies to matching sites
+ *          registered later, until reset
+ */
+struct Sites {
+    /**
+     * @brief Selects sites by filename, without path
+     * @param glob: StringRef, where '*' and '?' are wildcards
+     * @return Sites&
+     */
+    Sites& file(StringRef glob) {
+        rule.file = glob;
+        return *this;
+    }
+    /**
+     * @brief Selects sites by line range, inclusive
+     * @param first: long
+     * @param last: long
+     * @return Sites&
+     */
+    Sites& lines(long first, long last) {
+        rule.first = first;
+        rule.last = last;
+        return *this;
+    }
+    /**
+     * @brief Selects sites by tag
+     * @param glob: StringRef, where '*' and '?' are wildcards
+     * @return Sites&
+     */
+    Sites& tag(StringRef glob) {
+        rule.tag = glob;
+        return *this;
+    }
+    /**
+     * @brief Makes selected sites always log, whatever the levels
+     * @return size_t, number of registered sites matched
+     */
+    size_t enable() { return apply(SiteState::Enabled); }
+    /**
+     * @brief Makes selected sites never log
+     * @return size_t, number of registered sites matched
+     */
+    size_t disable() { return apply(SiteState::Disabled); }
+    /**
+     * @brief Makes selected sites filtered by levels again
+     * @return size_t, number of registered sites matched
+     */
+    size_t restore() { return apply(SiteState::ByLevel); }
+    /**
+     * @brief Describes selected registered sites
+     * @return std::vector<SiteInfo>
+     */
+    std::vector<SiteInfo> list() const {
+        return internal::Levels::instance().list(rule);
+    }
+    // ------------------------------
+    size_t apply(SiteState state) {
+        rule.state = state;
+        return internal::Levels::instance().apply(rule);
+    }
+    internal::SiteRule rule;
+};  // Sites
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Selects logging call sites, to enable / disable at run-time
+ *        e.g. R::sites().file("net*.cpp").lines(10, 40).enable();
+ * @return Sites, selecting all sites until narrowed down
+ */
+static inline Sites sites() { return Sites(); }
+
+// -----------------------------------------------------------
+
+namespace internal {
+
+/// all things in namespace internal are for internal use only
+
+// -----------------------------------------------------------
+
+/**
+ * @brief rlog's own stream type, returned by logging macros
+ *        Writes into an inline buffer, spilling to the heap only when it
+ *          is exceeded
+ *        Converts built-in types itself, without iostream sentries or
+ *          locales
+ *        Any other type, like the ones defined with R_USERTYPE_DEF, and
+ *          manipulators go through an std::ostream writing into the same
+ *          buffer, created on first use
+ * @note Floating point types use snprintf, and so expect the "C" numeric
+ *         locale, which is the default
+ */
+struct LogStream {
+    LogStream() { reset(); }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(LogStream);
+    // ------------------------------
+    LogStream& operator<<(bool value) {
+        return plain ? put(value ? '1' : '0') : viaOstream(value);
+    }
+    LogStream& operator<<(char value) {
+        return plain ? put(value) : viaOstream(value);
+    }
+    LogStream& operator<<(signed char value) {
+        return *this << static_cast<char>(value);
+    }
+    LogStream& operator<<(unsigned char value) {
+        return *this << static_cast<char>(value);
+    }
+    LogStream& operator<<(short value) { return decimal<long long>(value); }
+    LogStream& operator<<(unsigned short value) {
+        return decimal<unsigned long long>(value);
+    }
+    LogStream& operator<<(int value) { return decimal<long long>(value); }
+    LogStream& operator<<(unsigned value) {
+        return decimal<unsigned long long>(value);
+    }
+    LogStream& operator<<(long value) { return decimal<long long>(value); }
+    LogStream& operator<<(unsigned long value) {
+        return decimal<unsigned long long>(value);
+    }
+    LogStream& operator<<(long long value) {
+        return decimal<long long>(value);
+    }
+    LogStream& operator<<(unsigned long long value) {
+        return decimal<unsigned long long>(value);
+    }
+    LogStream& operator<<(float value) {
+        return floating(static_cast<double>(value));
+    }
+    LogStream& operator<<(double value) { return floating(value); }
+    LogStream& operator<<(long double value) { return floating(value); }
+    LogStream& operator<<(const char* value) {
+        if (!plain) {
+            return viaOstream(value);
+        }
+        // same as std::ostream, which prints nothing for nullptr
+        return value ? write(value, std::strlen(value)) : *this;
+    }
+    LogStream& operator<<(char* value) {
+        return *this << static_cast<const char*>(value);
+    }
+    LogStream& operator<<(const std::string& value) {
+        return plain ? write(value.data(), value.size()) : viaOstream(value);
+    }
+    LogStream& operator<<(StringRef value) {
+        return plain ? write(value.data(), value.size()) : viaOstream(value);
+    }
+    LogStream& operator<<(const void* value) {
+        if (!plain) {
+            return viaOstream(value);
+        }
+        if (!value) {
+            return put('0');
+        }
+        char number[numberSize];
+        char* const end = number + numberSize;
+        const char* const begin =
+            formatHex(end, reinterpret_cast<uintptr_t>(value));
+        return write(begin, end - begin);
+    }
+    template <typename T>
+    LogStream& operator<<(T* value) {
+        return *this << static_cast<const void*>(value);
+    }
+    LogStream& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+        using Manipulator = std::ostream& (*)(std::ostream&);
+        // common manipulators that only output a char, or nothing at all
+        if (manipulator == static_cast<Manipulator>(std::endl)) {
+            return put('\n');
+        }
+        if (manipulator == static_cast<Manipulator>(std::ends)) {
+            return put('\0');
+        }
+        if (manipulator == static_cast<Manipulator>(std::flush)) {
+            return *this;
+        }
+        return viaOstream(manipulator);
+    }
+    LogStream& operator<<(std::ios_base& (*manipulator)(std::ios_base&)) {
+        return viaOstream(manipulator);
+    }
+    template <typename T>
+    LogStream& operator<<(const T& value) {
+        return viaOstream(value);
+    }
+    // ------------------------------
+    /**
+     * @brief Appends raw chars
+     */
+    LogStream& write(const char* data, size_t size) {
+        if (static_cast<size_t>(end - cur) < size) {
+            grow(size);
+        }
+        std::memcpy(cur, data, size);
+        cur += size;
+        return *this;
+    }
+    LogStream& put(char c) {
+        if (cur == end) {
+            grow(1);
+        }
+        *cur++ = c;
+        return *this;
+    }
+    /**
+     * @brief Returns a view of the message written so far
+     * @return StringRef
+     */
+    StringRef view() const { return StringRef(begin, cur - begin); }
+    /**
+     * @brief Returns the message written so far as a string
+     *        The string is a member keeping its capacity across resets
+     * @return const std::string&
+     */
+    const std::string& str() {
+        const size_t size = cur - begin;
+        if (begin == local) {
+            heap.assign(local, size);
+        } else {
+            heap.resize(size);
+        }
+        // later writes carry on in the string
+        begin = &heap[0];
+        cur = end = begin + size;
+        return heap;
+    }
+    /**
+     * @brief Adds a typed key / value pair to the log
+     * @param key: string
+     * @param value: bool, number, string, or any type with an
+     *          std::ostream << operator
+     * @return LogStream&
+     */
+    template <typename K, typename V>
+    LogStream& kv(const K& key, const V& value) {
+        fields.add(key, value);
+        return *this;
+    }
+    /**
+     * @brief Empties the stream and its fields, and restores default
+     *          formatting
+     *        Heap storage keeps its capacity
+     */
+    void reset() {
+        fields.clear();
+        begin = cur = local;
+        end = local + sizeof(local);
+        if (adapter) {
+            rlog_ostream<std::ostream>& os = adapter->os;
+            os.clear();
+            os.flags(std::ios_base::dec | std::ios_base::skipws);
+            os.precision(6);
+            os.width(0);
+            os.fill(' ');
+        }
+        plain = true;
+    }
+    // ------------------------------
+    /**
+     * @brief Buffer of a LogStream, seen as std::streambuf
+     *        Lets std::ostream write in place
+     */
+    struct Adapter : std::streambuf {
+        explicit Adapter(LogStream& owner) : os(this), owner(owner) {}
+        R_INTERNAL_DISALLOW_COPY_ASSIGN(Adapter);
+        rlog_ostream<std::ostream>& attach() {
+            setp(owner.cur, owner.end);
+            return os;
+        }
+        void detach() { owner.cur = pptr(); }
+        int_type overflow(int_type c) override {
+            owner.cur = pptr();
+            owner.grow(1);
+            setp(owner.cur, owner.end);
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+        rlog_ostream<std::ostream> os;
+        LogStream& owner;
+    };  // Adapter
+    // ------------------------------
+    template <typename T>
+    LogStream& viaOstream(const T& value) {
+        if (!adapter) {
+            adapter.reset(new Adapter(*this));
+        }
+        rlog_ostream<std::ostream>& os = adapter->attach();
+        ::rlog_detail::insert(os, value);
+        adapter->detach();
+        // built-in types can skip the ostream only with default formatting
+        plain = os.flags() == (std::ios_base::dec | std::ios_base::skipws) &&
+                os.width() == 0 && os.precision() == 6;
+        return *this;
+    }
+    template <typename As, typename T>
+    LogStream& decimal(T value) {
+        if (!plain) {
+            return viaOstream(value);
+        }
+        char number[numberSize];
+        char* const end = number + numberSize;
+        const char* const begin = formatDecimal(end, static_cast<As>(value));
+        return write(begin, end - begin);
+    }
+    template <typename T>
+    LogStream& floating(T value) {
+        if (!plain) {
+            return viaOstream(value);
+        }
+        char number[numberSize];
+        return write(number, formatFloat(number, value));
+    }
+    /**
+     * @brief Makes room for at least size more chars
+     */
+    void grow(size_t size) {
+        const size_t used = cur - begin;
+        const size_t capacity =
+            std::max(2 * static_cast<size_t>(end - begin), used + size);
+        if (begin == local) {
+            heap.resize(std::max(capacity, heap.capacity()));
+            std::memcpy(&heap[0], local, used);
+        } else {
+            heap.resize(capacity);
+        }
+        begin = &heap[0];
+        cur = begin + used;
+        end = begin + heap.size();
+    }
+    // ------------------------------
+    // current storage, either local or heap
+    char* begin;
+    char* cur;
+    char* end;
+    char local[R_STREAM_INLINE_SIZE];
+    std::string heap;
+    std::unique_ptr<Adapter> adapter;
+    // true while formatting is default, see viaOstream
+    bool plain = true;
+    FieldList fields;
+    // ------------------------------
+    struct Pool {
+        std::vector<std::unique_ptr<LogStream>> streams;
+        size_t used = 0;
+    };
+    /**
+     * @brief getter for calling thread's pool of reusable streams
+     *        A Log leases the next free one, so that logs made while
+     *          streaming or from a sink get their own
+     */
+    static Pool& pool() {
+        static thread_local Pool pool;
+        return pool;
+    }
+    /**
+     * @brief Holds a leased stream of the calling thread's pool
+     *          for the lifetime of a Log
+     */
+    struct Lease {
+        Lease() : stream(acquire()) {}
+        ~Lease() { stream.reset(); --pool().used; }
+        R_INTERNAL_DISALLOW_COPY_ASSIGN(Lease);
+        static LogStream& acquire() {
+            Pool& pool = LogStream::pool();
+            if (pool.used == pool.streams.size()) {
+                pool.streams.emplace_back(new LogStream);
+            }
+            return *pool.streams[pool.used++];
+        }
+        const std::string& str() { return stream.str(); }
+        LogStream& stream;
+    };  // Lease
+};  // LogStream
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Single Log entry
+ *        Every time a log is made, an instance of this class is created
+ *          and its stream is filled, which is
+ *          - an ArgStream, with R_DEFERRED_FORMAT
+ *          - a LogStream leased from a thread-local pool,
+ *            with R_REUSE_THREAD_BUFFER
+ *          - its own LogStream otherwise
+ *        Destructor passes the stream to all the active Sinks,
+ *          or to the async backend when in async mode
+ */
+struct Log {
+    Log(const Site& site, StringRef tag = StringRef())
+        : metadata(site, tag) {}
+    explicit Log(const Check& check) : metadata(check.site, check.tag) {
+        metadata.suppressed = check.site.limiter.take();
+    }
+#if R_DEFERRED_FORMAT
+    ArgStream& stream() { return os; }
+    Record record() { return Record(std::move(metadata), std::move(os.args)); }
+#elif R_REUSE_THREAD_BUFFER
+    LogStream& stream() { return os.stream; }
+    Record record() {
+        return Record(std::move(metadata), std::string(os.str()));
+    }
+#else
+    LogStream& stream() { return os; }
+    Record record() {
+        return Record(std::move(metadata), std::string(os.str()));
+    }
+#endif
+    ~Log() {
+        metadata.fields = stream().fields.view();
+        if (AsyncBackend::instance().push([this] {
+                Record record = this->record();
+                record.own();
+                return record;
+            })) {
+            return;
+        }
+#if R_DEFERRED_FORMAT
+        Record record = this->record();
+        Store::instance().dispatch(record);
+#else
+        // the stream's string is handed to the sinks without a copy
+        Store::instance().dispatch(metadata, os.str());
+#endif
+    }
+#if R_DEFERRED_FORMAT
+    ArgStream os;
+#elif R_REUSE_THREAD_BUFFER
+    LogStream::Lease os;
+#else
+    LogStream os;
+#endif
+    Metadata metadata;
+};  // Log
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Returns string name of specified level
+ *
+ * @param level
+ * @return std::string
+ */
+static std::string to_string(Level level) {
+    switch (level) {
+        case Level::Info:
+            return "Info";
+        case Level::Warning:
+            return "Warning";
+        case Level::Error:
+            return "Error";
+        case Level::Off:
+            return "Off";
+        default:
+            assert(false);
+            return "None";
+    }
+}
+
+// -----------------------------------------------------------
+
+namespace internal {
+
+/// all things in namespace internal are for internal use only
+
+// -----------------------------------------------------------
+
+#if R_INTERNAL_SIMD
+
+/**
+ * @brief Index of the lowest set bit of a non-zero mask
+ */
+static inline unsigned lowestBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+#endif
+
+/**
+ * @brief Whether a character must be escaped in a json string
+ */
+static inline bool json_special(char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+/**
+ * @brief Writes a character that must be escaped in a json string,
+ *          escaped, i.e. 2 or 6 characters
+ * @param out: where to write: char*
+ * @param c: char
+ * @return end of what was written
+ */
+static inline char* json_escape(char* out, char c) {
+    static constexpr char hex[] = "0123456789abcdef";
+    *out++ = '\\';
+    switch (c) {
+        case '"':
+        case '\\':
+            *out++ = c;
+            break;
+        case '\n':
+            *out++ = 'n';
+            break;
+        case '\r':
+            *out++ = 'r';
+            break;
+        case '\t':
+            *out++ = 't';
+            break;
+        default:
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = hex[(c >> 4) & 0xf];
+            *out++ = hex[c & 0xf];
+    }
+    return out;
+}
+
+#if R_INTERNAL_SIMD
+
+/**
+ * @brief Escapes characters flagged by mask, in a vector at data + i
+ *        Appends the clean run before the vector at once, then the
+ *          vector up to its last flagged character, via a buffer, so
+ *          that dense escapes do not cost an append each
+ * @param clean: start of the run not appended yet: size_t&
+ */
+static inline void json_escape(std::string& out,
+                               const char* data,
+                               size_t i,
+                               unsigned mask,
+                               size_t& clean) {
+    if (mask == 0) {
+        return;
+    }
+    if (clean < i) {
+        out.append(data + clean, i - clean);
+        clean = i;
+    }
+    char buffer[R_INTERNAL_SIMD * 6];
+    char* cursor = buffer;
+    for (; mask != 0; mask &= mask - 1) {
+        const size_t at = i + lowestBit(mask);
+        std::memcpy(cursor, data + clean, at - clean);
+        cursor = json_escape(cursor + (at - clean), data[at]);
+        clean = at + 1;
+    }
+    out.append(buffer, cursor);
+}
+
+#endif
+
+/**
+ * @brief Appends a string as the content of a json string, i.e. escaped
+ *        Scans 32 or 16 bytes at a time, as R_INTERNAL_SIMD allows, for
+ *          characters to escape, copying runs of others at once
+ * @param out: std::string&
+ * @param value: StringRef
+ */
+static void json_escape(std::string& out, StringRef value) {
+    const char* const data = value.data();
+    const size_t size = value.size();
+    // start of the run not appended yet
+    size_t clean = 0;
+    size_t i = 0;
+    out.reserve(out.size() + size);
+#if R_INTERNAL_SIMD >= 32
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1f);
+        for (; i + 32 <= size; i += 32) {
+            const __m256i chunk = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(data + i));
+            // unsigned chunk <= 0x1f, as min(chunk, 0x1f) == chunk
+            const __m256i special = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                _mm256_cmpeq_epi8(chunk, backslash)),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+            json_escape(out,
+                        data,
+                        i,
+                        static_cast<unsigned>(_mm256_movemask_epi8(special)),
+                        clean);
+        }
+    }
+#endif
+#if R_INTERNAL_SIMD >= 16
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        for (; i + 16 <= size; i += 16) {
+            const __m128i chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                             _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+            json_escape(out,
+                        data,
+                        i,
+                        static_cast<unsigned>(_mm_movemask_epi8(special)),
+                        clean);
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        if (json_special(data[i])) {
+            char escaped[6];
+            out.append(data + clean, i - clean);
+            out.append(escaped, json_escape(escaped, data[i]));
+            clean = i + 1;
+        }
+    }
+    out.append(data + clean, size - clean);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Appends fields as a json object, with typed values
+ *          e.g. {"user": 42, "name": "foo"}
+ * @param out: std::string&
+ * @param fields: Fields
+ */
+static void json_fields(std::string& out, Fields fields) {
+    char number[numberSize];
+    char* const end = number + numberSize;
+    out += '{';
+    for (const auto& field : fields) {
+        if (&field != fields.begin()) {
+            out += ", ";
+        }
+        out += '"';
+        json_escape(out, field.key);
+        out += "\": ";
+        switch (field.type) {
+            case Field::Bool:
+                out += field.boolean ? "true" : "false";
+                break;
+            case Field::Int:
+                out.append(formatDecimal(end, field.integer), end);
+                break;
+            case Field::UInt:
+                out.append(formatDecimal(end, field.uinteger), end);
+                break;
+            case Field::Double:
+                // json has no infinity or nan
+                if (std::isfinite(field.real)) {
+                    out.append(number, formatFloat(number, field.real));
+                } else {
+                    out += "null";
+                }
+                break;
+            case Field::String:
+                out += '"';
+                json_escape(out, field.string);
+                out += '"';
+                break;
+        }
+    }
+    out += '}';
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A format of SmartFormatter, parsed once into pieces, i.e.
+ *          literal text and fields, that a log appends in turn
+ *        Fields are only formatted if present, e.g. #timestamp
+ *        With json, string fields are escaped as json string contents
+ */
+struct SmartFormat {
+    enum class Token {
+        Literal,
+        Timestamp,
+        Level,
+        Tag,
+        Filename,
+        Line,
+        Fields,
+        Message
+    };
+    struct Piece {
+        Token token;
+        std::string text;
+    };
+    struct Name {
+        const char* text;
+        Token token;
+    };
+    explicit SmartFormat(const std::string& format, bool json = false)
+        : json(json) {
+        static const Name names[] = {{"#timestamp", Token::Timestamp},
+                                     {"#level", Token::Level},
+                                     {"#tag", Token::Tag},
+                                     {"#filename", Token::Filename},
+                                     {"#line", Token::Line},
+                                     {"#fields", Token::Fields},
+                                     {"#message", Token::Message}};
+        size_t start = 0;
+        for (size_t pos = format.find('#'); pos != std::string::npos;
+             pos = format.find('#', pos + 1)) {
+            for (const auto& name : names) {
+                const size_t length = std::strlen(name.text);
+                if (format.compare(pos, length, name.text) == 0) {
+                    add(Token::Literal, format.substr(start, pos - start));
+                    add(name.token, std::string());
+                    start = pos + length;
+                    pos = start - 1;
+                    break;
+                }
+            }
+        }
+        add(Token::Literal, format.substr(start));
+    }
+    void add(Token token, std::string text) {
+        if (token != Token::Literal || !text.empty()) {
+            literalSize += text.size();
+            pieces.push_back(Piece{token, std::move(text)});
+        }
+    }
+    std::string operator()(const Metadata& metadata,
+                           const std::string& message) const {
+        char number[numberSize];
+        char* const end = number + numberSize;
+        std::string out;
+        // enough for all but fields, if each is present once
+        out.reserve(literalSize + message.size() + metadata.tag.size() +
+                    metadata.filename.size() + 40);
+        for (const auto& piece : pieces) {
+            switch (piece.token) {
+                case Token::Literal:
+                    out += piece.text;
+                    break;
+                case Token::Timestamp:
+                    out += metadata.timestamp();
+                    break;
+                case Token::Level:
+                    out += R::to_string(metadata.level);
+                    break;
+                case Token::Tag:
+                    if (!metadata.tag.empty()) {
+                        out += '#';
+                        append(out, metadata.tag);
+                    }
+                    break;
+                case Token::Filename:
+                    append(out, metadata.filename);
+                    break;
+                case Token::Line: {
+                    const long long line = metadata.line;
+                    out.append(formatDecimal(end, line), end);
+                    break;
+                }
+                case Token::Fields:
+                    json_fields(out, metadata.fields);
+                    break;
+                case Token::Message:
+                    append(out, message);
+                    break;
+            }
+        }
+        return out;
+    }
+    void append(std::string& out, StringRef value) const {
+        if (json) {
+            json_escape(out, value);
+        } else {
+            out.append(value.data(), value.size());
+        }
+    }
+    std::vector<Piece> pieces;
+    size_t literalSize = 0;
+    // escapes tag, filename & message, for a format of json
+    bool json = false;
+};  // SmartFormat
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Character i of a string, or '\0' past its end
+ *        constexpr, for R_SMART_FORMAT to spell out a format as
+ *          template arguments
+ */
+static constexpr char charAt(const char* text, size_t i) {
+    return i == 0 || *text == '\0' ? *text : charAt(text + 1, i - 1);
+}
+
+/**
+ * @brief Values of a log's fields, for a StaticFormat
+ *        Timestamp and fields are only formatted if asked for
+ */
+struct StaticValues {
+    using Token = SmartFormat::Token;
+    StaticValues(const Metadata& metadata,
+                 const std::string& message,
+                 bool timestamp,
+                 bool fields)
+        : level(R::to_string(metadata.level)) {
+        if (timestamp) {
+            at(Token::Timestamp) = metadata.timestamp();
+        }
+        at(Token::Level) = level;
+        at(Token::Tag) = metadata.tag;
+        at(Token::Filename) = metadata.filename;
+        const long long line = metadata.line;
+        char* const end = number + numberSize;
+        const char* first = formatDecimal(end, line);
+        at(Token::Line) = StringRef(first, end - first);
+        if (fields) {
+            json_fields(fieldsText, metadata.fields);
+            at(Token::Fields) = fieldsText;
+        }
+        at(Token::Message) = message;
+    }
+    StringRef& at(Token token) { return values[static_cast<size_t>(token)]; }
+    StringRef at(Token token) const {
+        return values[static_cast<size_t>(token)];
+    }
+    StringRef values[static_cast<size_t>(Token::Message) + 1];
+    std::string level;
+    std::string fieldsText;
+    char number[numberSize];
+};  // StaticValues
+
+/**
+ * @brief Pieces of a StaticFormat, i.e. literal text & fields
+ *        Each sizes and writes itself, given a log's values
+ */
+template <char... Chars>
+struct StaticText {
+    static constexpr SmartFormat::Token token = SmartFormat::Token::Literal;
+    static size_t size(const StaticValues&) { return sizeof...(Chars); }
+    static void write(char*& out, const StaticValues&) {
+        static constexpr char text[] = {Chars...};
+        std::memcpy(out, text, sizeof(text));
+        out += sizeof(text);
+    }
+};  // StaticText
+
+template <SmartFormat::Token Token>
+struct StaticField {
+    static constexpr SmartFormat::Token token = Token;
+    static size_t size(const StaticValues& values) {
+        return values.at(Token).size();
+    }
+    static void write(char*& out, const StaticValues& values) {
+        const StringRef value = values.at(Token);
+        std::memcpy(out, value.data(), value.size());
+        out += value.size();
+    }
+};  // StaticField
+
+/// a tag is prefixed with #, if there is one
+template <>
+struct StaticField<SmartFormat::Token::Tag> {
+    static constexpr SmartFormat::Token token = SmartFormat::Token::Tag;
+    static size_t size(const StaticValues& values) {
+        const StringRef tag = values.at(token);
+        return tag.empty() ? 0 : tag.size() + 1;
+    }
+    static void write(char*& out, const StaticValues& values) {
+        const StringRef tag = values.at(token);
+        if (!tag.empty()) {
+            *out++ = '#';
+            std::memcpy(out, tag.data(), tag.size());
+            out += tag.size();
+        }
+    }
+};  // StaticField
+
+/**
+ * @brief Whether token is any of the others
+ */
+static constexpr bool contains(SmartFormat::Token) { return false; }
+
+template <typename... Tokens>
+static constexpr bool contains(SmartFormat::Token token,
+                               SmartFormat::Token first,
+                               Tokens... rest) {
+    return first == token || contains(token, rest...);
+}
+
+/**
+ * @brief A SmartFormatter whose format was parsed at compile time, into
+ *          its pieces, see R_SMART_FORMAT
+ *        A log sizes all pieces first, so that the result is allocated
+ *          once, then writes them in turn
+ */
+template <typename... Pieces>
+struct StaticFormat {
+    using Token = SmartFormat::Token;
+    template <typename Piece>
+    using Add = StaticFormat<Pieces..., Piece>;
+    std::string operator()(const Metadata& metadata,
+                           const std::string& message) const {
+        const StaticValues values(metadata,
+                                  message,
+                                  contains(Token::Timestamp, Pieces::token...),
+                                  contains(Token::Fields, Pieces::token...));
+        size_t size = 0;
+        const int sizes[] = {0, (size += Pieces::size(values), 0)...};
+        std::string out(size, '\0');
+        char* cursor = &out[0];
+        const int writes[] = {0, (Pieces::write(cursor, values), 0)...};
+        (void)sizes;
+        (void)writes;
+        (void)cursor;
+        return out;
+    }
+};  // StaticFormat
+
+/**
+ * @brief Adds text to a StaticFormat, unless empty
+ */
+template <typename Format, typename Text>
+struct AddText {
+    using type = typename Format::template Add<Text>;
+};
+
+template <typename Format>
+struct AddText<Format, StaticText<>> {
+    using type = Format;
+};
+
+/**
+ * @brief Parses characters of a format into a StaticFormat, a character
+ *          at a time, collecting text until a field, or '\0'
+ */
+template <typename Format, typename Text, char... Chars>
+struct ParseFormat;
+
+template <typename Format, char... Text>
+struct ParseFormat<Format, StaticText<Text...>> {
+    using type = typename AddText<Format, StaticText<Text...>>::type;
+};
+
+template <typename Format, char... Text, char... Rest>
+struct ParseFormat<Format, StaticText<Text...>, '\0', Rest...>
+    : ParseFormat<Format, StaticText<Text...>> {};
+
+template <typename Format, char... Text, char C, char... Rest>
+struct ParseFormat<Format, StaticText<Text...>, C, Rest...>
+    : ParseFormat<Format, StaticText<Text..., C>, Rest...> {};
+
+#define R_INTERNAL_PARSE_FIELD(_token, ...)                                 \
+    template <typename Format, char... Text, char... Rest>                  \
+    struct ParseFormat<Format, StaticText<Text...>, '#', __VA_ARGS__,       \
+                       Rest...>                                             \
+        : ParseFormat<typename AddText<Format, StaticText<Text...>>::type:: \
+                          template Add<StaticField<SmartFormat::Token::     \
+                                                       _token>>,            \
+                      StaticText<>,                                         \
+                      Rest...> {};
+
+R_INTERNAL_PARSE_FIELD(Timestamp, 't', 'i', 'm', 'e', 's', 't', 'a', 'm', 'p')
+R_INTERNAL_PARSE_FIELD(Level, 'l', 'e', 'v', 'e', 'l')
+R_INTERNAL_PARSE_FIELD(Tag, 't', 'a', 'g')
+R_INTERNAL_PARSE_FIELD(Filename, 'f', 'i', 'l', 'e', 'n', 'a', 'm', 'e')
+R_INTERNAL_PARSE_FIELD(Line, 'l', 'i', 'n', 'e')
+R_INTERNAL_PARSE_FIELD(Fields, 'f', 'i', 'e', 'l', 'd', 's')
+R_INTERNAL_PARSE_FIELD(Message, 'm', 'e', 's', 's', 'a', 'g', 'e')
+
+#undef R_INTERNAL_PARSE_FIELD
+
+/**
+ * @brief StaticFormat of a format, spelled out as characters
+ */
+template <bool Fits, char... Chars>
+struct StaticFormatOf {
+    static_assert(Fits, "R_SMART_FORMAT: format is too long");
+    using type =
+        typename ParseFormat<StaticFormat<>, StaticText<>, Chars...>::type;
+};
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A type that helps a sink filter logging based on metadata and
+ * message Being a std::function, it can capture any callable with signature
+ * bool(const Metadata&, const std::string&) Returned value can be used by a
+ * Sink to filter logging
+ */
+using Filter = std::function<bool(const Metadata&, const std::string&)>;
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A utility function to compose a given filter and sink to form a
+ * new sink
+ */
+static const auto makeFilteredSink = [](const Sink& sink,
+                                        const Filter& filter) -> Sink {
+    return R_SINK_W_CAPTURE(metadata, message, =) {
+        if (filter(metadata, message)) {
+            sink(metadata, message);
+        }
+    };
+};
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A type that helps a sink format its logs based on metadata and
+ * message Being a std::function, it can capture any callable with signature
+ * std::string(const Metadata&, const std::string&) Returned value can be
+ * used by a Sink instead of raw message
+ */
+using Formatter =
+    std::function<std::string(const Metadata&, const std::string&)>;
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A utility function to compose a given filter and formatter to form
+ * a new sink
+ */
+static const auto makeFormattedSink = [](const Sink& sink,
+                                         const Formatter& formatter) -> Sink {
+    return R_SINK_W_CAPTURE(metadata, message, =) {
+        sink(metadata, formatter(metadata, message));
+    };
+};
+
+// -----------------------------------------------------------
+
+namespace internal {
+
+/// all things in namespace internal are for internal use only
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A stage of a pipe, followed by the rest of it
+ *        A stage returning bool filters, passing the log on only if
+ *          true, while one returning a string formats the message
+ *        Concrete types, so that the whole pipe can be inlined
+ */
+template <typename Stage, typename Next>
+struct Piped {
+    using Result = decltype(std::declval<Stage&>()(
+        std::declval<const Metadata&>(), std::declval<const std::string&>()));
+    void operator()(const Metadata& metadata, const std::string& message) {
+        pass(metadata, message, std::is_same<Result, bool>());
+    }
+    void pass(const Metadata& metadata,
+              const std::string& message,
+              std::true_type /* filter */) {
+        if (stage(metadata, message)) {
+            next(metadata, message);
+        }
+    }
+    void pass(const Metadata& metadata,
+              const std::string& message,
+              std::false_type /* formatter */) {
+        next(metadata, stage(metadata, message));
+    }
+    Stage stage;
+    Next next;
+};  // Piped
+
+/**
+ * @brief Type of a pipe of given stages, the last being the Sink
+ */
+template <typename... Stages>
+struct Pipeline;
+
+template <typename Last>
+struct Pipeline<Last> {
+    using type = Last;
+    static type make(Last&& last) { return std::move(last); }
+};  // Pipeline
+
+template <typename Stage, typename... Rest>
+struct Pipeline<Stage, Rest...> {
+    using type = Piped<Stage, typename Pipeline<Rest...>::type>;
+    static type make(Stage&& stage, Rest&&... rest) {
+        return type{std::move(stage),
+                    Pipeline<Rest...>::make(std::move(rest)...)};
+    }
+};  // Pipeline
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Composes filters, formatters and a sink into a new sink,
+ *          like makeFilteredSink & makeFormattedSink, but without any
+ *          std::function in between, so that calls can be inlined
+ *        Stages are applied in order, those returning bool as filters,
+ *          those returning std::string as formatters
+ *        Stages are copied, pass non-copyable ones via std::ref
+ * @usage R::addSink(R::pipe(errorsOnly, R::JsonFormatter, std::ref(file)));
+ * @param stages...: filters and formatters, then a sink
+ * @return a sink of its own type, i.e. a Sink compatible callable
+ */
+template <typename... Stages>
+static typename internal::Pipeline<typename std::decay<Stages>::type...>::type
+pipe(Stages&&... stages) {
+    return internal::Pipeline<typename std::decay<Stages>::type...>::make(
+        typename std::decay<Stages>::type(std::forward<Stages>(stages))...);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A sink passing every log to each of a fixed set of sinks, held
+ *          in a std::tuple by their concrete types
+ *        Added as a single Sink, it takes one indirect call per log for
+ *          all its sinks, which the compiler can otherwise inline
+ * @usage auto logger = R::makeLogger(R::pipe(fmt, std::ref(file)),
+ *                                    counter);
+ *        R::addSink(std::ref(logger));
+ */
+template <typename... Sinks>
+struct Logger {
+    explicit Logger(Sinks... sinks) : sinks(std::move(sinks)...) {}
+    R_SINK_OPERATOR(metadata, message) { send<0>(metadata, message); }
+    template <size_t I>
+    typename std::enable_if<(I < sizeof...(Sinks))>::type send(
+        const Metadata& metadata,
+        const std::string& message) {
+        std::get<I>(sinks)(metadata, message);
+        send<I + 1>(metadata, message);
+    }
+    template <size_t I>
+    typename std::enable_if<(I == sizeof...(Sinks))>::type send(
+        const Metadata&,
+        const std::string&) {}
+    std::tuple<Sinks...> sinks;
+};  // Logger
+
+/**
+ * @brief Makes a Logger of given sinks, copied like pipe's stages
+ * @param sinks...: any Sink compatible callables
+ * @return Logger
+ */
+template <typename... Sinks>
+static Logger<typename std::decay<Sinks>::type...> makeLogger(
+    Sinks&&... sinks) {
+    return Logger<typename std::decay<Sinks>::type...>(
+        std::forward<Sinks>(sinks)...);
+}
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A built-in basic cout sink
+ * @note Adds an endl and therefore a flush after every log
+ */
+static const Sink CoutSink = R_SINK(metadata, message) {
+    std::cout << message << std::endl;
+};
 
 /**
  * @brief A built-in basic file sink
@@ -467,31 +4823,24 @@ static const auto FileSink = [](std::ofstream& fs) -> Sink {
 /**
  * @brief Default format of SmartFormatter
  */
-static const auto defaultSmartFormat =
+static constexpr auto defaultSmartFormat =
     "[R] #timestamp [#level] #tag (#filename:#line) #message";
 
 /**
  * @brief A utility to make a built-in intelligent formatter
  *        Using a string format, allows puting together metadata values in
  *          custom fashion
+ *        The format is parsed once, here, and every occurrence of each
+ *          field is replaced, never those within the values themselves
+ *        defaultSmartFormat is parsed at compile time, see R_SMART_FORMAT
  * @param format: const std::string& : default: defaultSmartFormat
  */
 static const auto makeSmartFormatter = [](const std::string& format =
                                               defaultSmartFormat) -> Formatter {
-    return R_FORMATTER_W_CAPTURE(metadata, message, format) {
-        std::string result = format;
-        internal::string_replace(result, "#timestamp", metadata.timestamp);
-        internal::string_replace(result, "#level", to_string(metadata.level));
-        internal::string_replace(
-            result,
-            "#tag",
-            metadata.tag.empty() ? "" : std::string("#") + metadata.tag);
-        internal::string_replace(result, "#filename", metadata.filename);
-        internal::string_replace(
-            result, "#line", std::to_string(metadata.line));
-        internal::string_replace(result, "#message", message);
-        return result;
-    };
+    if (format == defaultSmartFormat) {
+        return R_SMART_FORMAT(defaultSmartFormat);
+    }
+    return internal::SmartFormat(format);
 };
 
 // -----------------------------------------------------------
@@ -510,8 +4859,9 @@ static const auto makeSmartFormattedCoutSink =
 /**
  * @brief A built-in json formatter
  *        Simply gives a special format for SmartFormatter :)
+ *        Tag, filename & message are escaped, so output is always json
  */
-static const Formatter JsonFormatter = makeSmartFormatter(
+static const Formatter JsonFormatter = internal::SmartFormat(
     R"(
     {
         "timestamp": "#timestamp",
@@ -519,8 +4869,10 @@ static const Formatter JsonFormatter = makeSmartFormatter(
         "tag": "#tag",
         "filename": "#filename",
         "line": #line,
+        "fields": #fields,
         "message": "#message"
-    })");
+    })",
+    true);
 
 // -----------------------------------------------------------
 
@@ -549,6 +4901,915 @@ struct JsonSink {
 
 // -----------------------------------------------------------
 
+namespace internal {
+
+/// all things in namespace internal are for internal use only
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Layout of files written by BinarySink
+ *        Starts with magic, followed by entries, each starting with a
+ *          kind byte
+ *        Site: id, level, line, filename, tag, message of its first log,
+ *          and types of its first log's arguments, if deferred, written
+ *          once per site, as a varint count + 1, or 0, followed by a type
+ *          byte per argument, and the text of string arguments
+ *        Key: id & key of a field, written once per key
+ *        Log: site id, time delta from previous log, suppressed count,
+ *          message, and fields as key id, type & value
+ *        Message: an encoding byte, followed by
+ *          Args: a varint of bits set for the strings that differ from
+ *            the site's, then the value of each argument of the site's
+ *            types, leaving out the strings that do not differ
+ *          Pieces: the numbers of the text, if all the rest is the same
+ *            as the site's message, see splitPieces
+ *          Text: the whole string
+ *        Integers are LEB128 varints, signed ones zigzag encoded first,
+ *          floats and doubles are 4 and 8 little-endian bytes, and
+ *          strings are a varint size followed by their chars
+ */
+struct Binary {
+    static constexpr const char* magic() { return "RLOG\x02"; }
+    static constexpr size_t magicSize = 5;
+    enum Kind : char { SiteEntry = 'S', KeyEntry = 'K', LogEntry = 'L' };
+    enum Encoding : char { Args = 'A', Pieces = 'P', Text = 'T' };
+    // longest run of digits stored as a number, fits unsigned long long
+    static constexpr size_t maxDigits = 19;
+    // ------------------------------
+    static void putVarint(std::string& out, unsigned long long value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+    static void putSigned(std::string& out, long long value) {
+        putVarint(out,
+                  (static_cast<unsigned long long>(value) << 1) ^
+                      static_cast<unsigned long long>(value >> 63));
+    }
+    static void putString(std::string& out, StringRef value) {
+        putVarint(out, value.size());
+        out.append(value.data(), value.size());
+    }
+    static void putDouble(std::string& out, double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            out += static_cast<char>(bits >> (8 * i));
+        }
+    }
+    static void putFloat(std::string& out, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 4; ++i) {
+            out += static_cast<char>(bits >> (8 * i));
+        }
+    }
+    // ------------------------------
+    static bool getVarint(std::istream& is, unsigned long long& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const int c = is.get();
+            if (c == EOF) {
+                return false;
+            }
+            value |= static_cast<unsigned long long>(c & 0x7f) << shift;
+            if (!(c & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    static bool getSigned(std::istream& is, long long& value) {
+        unsigned long long raw;
+        if (!getVarint(is, raw)) {
+            return false;
+        }
+        value = static_cast<long long>(raw >> 1) ^
+                -static_cast<long long>(raw & 1);
+        return true;
+    }
+    /**
+     * @brief Reads a string, growing it only as its chars are read, so
+     *          that a corrupt size fails at the end of input, rather than
+     *          allocating all of it upfront
+     */
+    static bool getString(std::istream& is, std::string& value) {
+        unsigned long long size;
+        if (!getVarint(is, size)) {
+            return false;
+        }
+        value.clear();
+        while (size > 0) {
+            const size_t chunk =
+                static_cast<size_t>(std::min<unsigned long long>(size, 4096));
+            const size_t at = value.size();
+            value.resize(at + chunk);
+            if (!is.read(&value[at], chunk)) {
+                return false;
+            }
+            size -= chunk;
+        }
+        return true;
+    }
+    static bool getDouble(std::istream& is, double& value) {
+        unsigned char bytes[8];
+        if (!is.read(reinterpret_cast<char*>(bytes), 8)) {
+            return false;
+        }
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+    static bool getFloat(std::istream& is, float& value) {
+        unsigned char bytes[4];
+        if (!is.read(reinterpret_cast<char*>(bytes), 4)) {
+            return false;
+        }
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; ++i) {
+            bits |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+        }
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+    // ------------------------------
+    /**
+     * @brief Returns the size of the run of digits at pos
+     */
+    static size_t digits(const char* pos, const char* end) {
+        const char* const begin = pos;
+        while (pos != end && *pos >= '0' && *pos <= '9') {
+            ++pos;
+        }
+        return pos - begin;
+    }
+    /**
+     * @brief Whether a run of digits is stored as a number, i.e. it is
+     *          written back the same, without leading zeros
+     */
+    static bool isNumber(const char* pos, size_t count) {
+        return count > 0 && count <= maxDigits && (*pos != '0' || count == 1);
+    }
+    /**
+     * @brief Splits the message of the first log of a site into the
+     *          literals around its numbers, so that later logs of the site
+     *          only store their numbers, when the literals are the same
+     * @param text: StringRef
+     * @param literals: std::vector<std::string>&, one more than numbers
+     */
+    static void splitPieces(StringRef text,
+                            std::vector<std::string>& literals) {
+        literals.assign(1, std::string());
+        const char* pos = text.begin();
+        while (pos != text.end()) {
+            const size_t count = digits(pos, text.end());
+            if (isNumber(pos, count)) {
+                literals.emplace_back();
+                pos += count;
+            } else if (count > 0) {
+                literals.back().append(pos, count);
+                pos += count;
+            } else {
+                literals.back() += *pos++;
+            }
+        }
+    }
+    /**
+     * @brief Writes the numbers of a message, if it is made of given
+     *          literals around them
+     * @param out: std::string&
+     * @param text: StringRef
+     * @param literals: const std::vector<std::string>&
+     * @return bool, false if the message is not, leaving out as it was
+     */
+    static bool putPieces(std::string& out,
+                          StringRef text,
+                          const std::vector<std::string>& literals) {
+        const size_t mark = out.size();
+        const char* pos = text.begin();
+        for (size_t i = 0; i < literals.size(); ++i) {
+            if (i > 0) {
+                const size_t count = digits(pos, text.end());
+                if (!isNumber(pos, count)) {
+                    out.resize(mark);
+                    return false;
+                }
+                unsigned long long value = 0;
+                for (const char* const end = pos + count; pos != end; ++pos) {
+                    value = value * 10 + (*pos - '0');
+                }
+                putVarint(out, value);
+            }
+            const std::string& literal = literals[i];
+            if (static_cast<size_t>(text.end() - pos) < literal.size() ||
+                literal.compare(0, literal.size(), pos, literal.size()) != 0) {
+                out.resize(mark);
+                return false;
+            }
+            pos += literal.size();
+        }
+        if (pos != text.end()) {
+            out.resize(mark);
+            return false;
+        }
+        return true;
+    }
+    /**
+     * @brief Reads the numbers of a message, and puts it back together
+     *          with the literals of its site
+     */
+    static bool getPieces(std::istream& is,
+                          const std::vector<std::string>& literals,
+                          std::string& text) {
+        text = literals[0];
+        for (size_t i = 1; i < literals.size(); ++i) {
+            unsigned long long value;
+            if (!getVarint(is, value)) {
+                return false;
+            }
+            text += std::to_string(value);
+            text += literals[i];
+        }
+        return true;
+    }
+    // ------------------------------
+    // an argument of the first log of a site, and its text if a string
+    struct Arg {
+        ArgBuffer::Type type;
+        std::string piece;
+    };
+    /**
+     * @brief Gets the types of the arguments of a log
+     * @param args: const ArgBuffer&
+     * @param types: std::vector<Arg>&
+     * @return bool, false if any is not stored as is, i.e. pointers, long
+     *          doubles and manipulators, or if there are more strings than
+     *          bits of a varint
+     */
+    static bool signature(const ArgBuffer& args, std::vector<Arg>& types) {
+        types.clear();
+        if (args.replay) {
+            return false;
+        }
+        const char* pos = args.data();
+        const char* const end = pos + args.size;
+        size_t strings = 0;
+        while (pos != end) {
+            const ArgBuffer::Type type = ArgBuffer::read<ArgBuffer::Type>(pos);
+            types.push_back({type, std::string()});
+            if (type == ArgBuffer::String && ++strings > 64) {
+                return false;
+            }
+            if (type == ArgBuffer::String) {
+                const size_t count = ArgBuffer::read<size_t>(pos);
+                types.back().piece.assign(pos, count);
+                pos += count;
+            } else if (type == ArgBuffer::LongDouble ||
+                       type > ArgBuffer::String) {
+                return false;
+            } else {
+                pos += argSize(type);
+            }
+        }
+        return true;
+    }
+    static size_t argSize(ArgBuffer::Type type) {
+        switch (type) {
+            case ArgBuffer::Bool:
+                return sizeof(bool);
+            case ArgBuffer::Char:
+                return sizeof(char);
+            case ArgBuffer::Short:
+            case ArgBuffer::UShort:
+                return sizeof(short);
+            case ArgBuffer::Int:
+            case ArgBuffer::UInt:
+                return sizeof(int);
+            case ArgBuffer::Long:
+            case ArgBuffer::ULong:
+                return sizeof(long);
+            case ArgBuffer::LongLong:
+            case ArgBuffer::ULongLong:
+                return sizeof(long long);
+            case ArgBuffer::Float:
+                return sizeof(float);
+            default:
+                return sizeof(double);
+        }
+    }
+    /**
+     * @brief Writes the values of the arguments of a log, if of given
+     *          types
+     * @param out: std::string&
+     * @param args: const ArgBuffer&
+     * @param types: const std::vector<Arg>&
+     * @return bool, false if they are not, writing nothing
+     */
+    static bool putArgs(std::string& out,
+                        const ArgBuffer& args,
+                        const std::vector<Arg>& types) {
+        // checks the types first, and which strings differ
+        unsigned long long changed = 0;
+        size_t strings = 0;
+        const char* pos = args.data();
+        const char* const end = pos + args.size;
+        for (const Arg& arg : types) {
+            if (pos == end ||
+                ArgBuffer::read<ArgBuffer::Type>(pos) != arg.type) {
+                return false;
+            }
+            if (arg.type != ArgBuffer::String) {
+                pos += argSize(arg.type);
+                continue;
+            }
+            const size_t count = ArgBuffer::read<size_t>(pos);
+            if (arg.piece.size() != count ||
+                arg.piece.compare(0, count, pos, count) != 0) {
+                changed |= 1ull << strings;
+            }
+            ++strings;
+            pos += count;
+        }
+        if (pos != end) {
+            return false;
+        }
+        putVarint(out, changed);
+        strings = 0;
+        pos = args.data();
+        for (const Arg& arg : types) {
+            ++pos;
+            switch (arg.type) {
+                case ArgBuffer::Bool:
+                    out += static_cast<char>(ArgBuffer::read<bool>(pos));
+                    break;
+                case ArgBuffer::Char:
+                    out += ArgBuffer::read<char>(pos);
+                    break;
+                case ArgBuffer::Short:
+                    putSigned(out, ArgBuffer::read<short>(pos));
+                    break;
+                case ArgBuffer::UShort:
+                    putVarint(out, ArgBuffer::read<unsigned short>(pos));
+                    break;
+                case ArgBuffer::Int:
+                    putSigned(out, ArgBuffer::read<int>(pos));
+                    break;
+                case ArgBuffer::UInt:
+                    putVarint(out, ArgBuffer::read<unsigned>(pos));
+                    break;
+                case ArgBuffer::Long:
+                    putSigned(out, ArgBuffer::read<long>(pos));
+                    break;
+                case ArgBuffer::ULong:
+                    putVarint(out, ArgBuffer::read<unsigned long>(pos));
+                    break;
+                case ArgBuffer::LongLong:
+                    putSigned(out, ArgBuffer::read<long long>(pos));
+                    break;
+                case ArgBuffer::ULongLong:
+                    putVarint(out, ArgBuffer::read<unsigned long long>(pos));
+                    break;
+                case ArgBuffer::Float:
+                    putFloat(out, ArgBuffer::read<float>(pos));
+                    break;
+                case ArgBuffer::Double:
+                    putDouble(out, ArgBuffer::read<double>(pos));
+                    break;
+                default: {
+                    const size_t count = ArgBuffer::read<size_t>(pos);
+                    if (changed & (1ull << strings++)) {
+                        putString(out, StringRef(pos, count));
+                    }
+                    pos += count;
+                } break;
+            }
+        }
+        return true;
+    }
+    /**
+     * @brief Reads the values of the arguments of a log of given types
+     */
+    static bool getArgs(std::istream& is,
+                        const std::vector<Arg>& types,
+                        ArgBuffer& args,
+                        std::string& value) {
+        args.clear();
+        unsigned long long changed;
+        if (!getVarint(is, changed)) {
+            return false;
+        }
+        size_t strings = 0;
+        for (const Arg& arg : types) {
+            long long integer;
+            unsigned long long uinteger;
+            float single;
+            double real;
+            switch (arg.type) {
+                case ArgBuffer::Bool:
+                case ArgBuffer::Char: {
+                    const int c = is.get();
+                    if (c == EOF) {
+                        return false;
+                    }
+                    if (arg.type == ArgBuffer::Bool) {
+                        args.put(arg.type, c != 0);
+                    } else {
+                        args.put(arg.type, static_cast<char>(c));
+                    }
+                } break;
+                case ArgBuffer::Short:
+                case ArgBuffer::Int:
+                case ArgBuffer::Long:
+                case ArgBuffer::LongLong:
+                    if (!getSigned(is, integer)) {
+                        return false;
+                    }
+                    // rendered the same, whatever its size
+                    args.put(ArgBuffer::LongLong, integer);
+                    break;
+                case ArgBuffer::UShort:
+                case ArgBuffer::UInt:
+                case ArgBuffer::ULong:
+                case ArgBuffer::ULongLong:
+                    if (!getVarint(is, uinteger)) {
+                        return false;
+                    }
+                    args.put(ArgBuffer::ULongLong, uinteger);
+                    break;
+                case ArgBuffer::Float:
+                    if (!getFloat(is, single)) {
+                        return false;
+                    }
+                    args.put(arg.type, single);
+                    break;
+                case ArgBuffer::Double:
+                    if (!getDouble(is, real)) {
+                        return false;
+                    }
+                    args.put(arg.type, real);
+                    break;
+                default:
+                    if (!(changed & (1ull << strings++))) {
+                        args.putString(arg.piece.data(), arg.piece.size());
+                        break;
+                    }
+                    if (!getString(is, value)) {
+                        return false;
+                    }
+                    args.putString(value.data(), value.size());
+                    break;
+            }
+        }
+        return true;
+    }
+};  // Binary
+
+// -----------------------------------------------------------
+
+}  // namespace internal
+
+// -----------------------------------------------------------
+
+/**
+ * @brief A built-in compact binary sink
+ *        Writes every call site, i.e. level, filename, line, tag & the
+ *          literals of its message only once, and then per log only a
+ *          site id, a time delta and varint encoded values
+ *        Files are turned back into text or json by BinaryDecoder, or
+ *          the rlog-decode tool
+ * @note Should be passed to RLog only as a reference, using std::ref
+ * @usage R::BinarySink binary(fs);
+ *        R::addSink(std::ref(binary));
+ */
+struct BinarySink {
+    explicit BinarySink(std::ostream& os) : os(os) {
+        os.write(internal::Binary::magic(), internal::Binary::magicSize);
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(BinarySink);
+    R_SINK_OPERATOR(metadata, message) {
+        using internal::Binary;
+        buffer.clear();
+        // new sites and keys are written first
+        const unsigned long long id = site(metadata, message);
+        keyIds.clear();
+        for (const auto& field : metadata.fields) {
+            keyIds.push_back(key(field.key));
+        }
+        buffer += Binary::LogEntry;
+        Binary::putVarint(buffer, id);
+        const long long time = metadata.nanoseconds();
+        Binary::putSigned(buffer, time - last);
+        last = time;
+        Binary::putVarint(buffer, metadata.suppressed);
+        putMessage(id, metadata, message);
+        Binary::putVarint(buffer, metadata.fields.size());
+        for (size_t i = 0; i < metadata.fields.size(); ++i) {
+            const Field& field = metadata.fields[i];
+            Binary::putVarint(buffer, keyIds[i]);
+            buffer += static_cast<char>(field.type);
+            switch (field.type) {
+                case Field::Bool:
+                    buffer += static_cast<char>(field.boolean);
+                    break;
+                case Field::Int:
+                    Binary::putSigned(buffer, field.integer);
+                    break;
+                case Field::UInt:
+                    Binary::putVarint(buffer, field.uinteger);
+                    break;
+                case Field::Double:
+                    Binary::putDouble(buffer, field.real);
+                    break;
+                case Field::String:
+                    Binary::putString(buffer, field.string);
+                    break;
+            }
+        }
+        os.write(buffer.data(), buffer.size());
+    }
+    /**
+     * @brief Writes the message of a log, as the values of its arguments,
+     *          or its numbers, when the rest is the same as the first log
+     *          of its site
+     * @param id: unsigned long long, of its site
+     * @param metadata: const Metadata&
+     * @param message: const std::string&
+     */
+    void putMessage(unsigned long long id,
+                    const Metadata& metadata,
+                    const std::string& message) {
+        using internal::Binary;
+        const Template& site = templates[id];
+        buffer += Binary::Args;
+        if (site.typed && metadata.args &&
+            Binary::putArgs(buffer, *metadata.args, site.types)) {
+            return;
+        }
+        buffer.back() = Binary::Pieces;
+        if (Binary::putPieces(buffer, message, site.literals)) {
+            return;
+        }
+        buffer.back() = Binary::Text;
+        Binary::putString(buffer, message);
+    }
+    /**
+     * @brief Returns id of the call site of a log, writing it first if new
+     *        Logs made by the logging macros are looked up by their site
+     *          and tag, first in a small cache, so that they are neither
+     *          encoded nor looked up in a map per log
+     * @param metadata: const Metadata&
+     * @param message: const std::string&
+     * @return unsigned long long
+     */
+    unsigned long long site(const Metadata& metadata,
+                            const std::string& message) {
+        if (!metadata.site) {
+            return encodedSite(metadata, message);
+        }
+        Cached& cached =
+            cache[(reinterpret_cast<size_t>(metadata.site) >> 4) & 63];
+        if (cached.site == metadata.site &&
+            StringRef(cached.tag) == metadata.tag) {
+            return cached.id;
+        }
+        // a site logs more than one tag only if given at run time
+        std::vector<Cached>& tags = sites[metadata.site];
+        for (const Cached& known : tags) {
+            if (StringRef(known.tag) == metadata.tag) {
+                cached = known;
+                return cached.id;
+            }
+        }
+        tags.push_back(
+            {metadata.site, metadata.tag, writeSite(metadata, message)});
+        cached = tags.back();
+        return cached.id;
+    }
+    /**
+     * @brief Returns id of the call site of a log made without the logging
+     *          macros, keyed by its encoding
+     * @param metadata: const Metadata&
+     * @param message: const std::string&
+     * @return unsigned long long
+     */
+    unsigned long long encodedSite(const Metadata& metadata,
+                                   const std::string& message) {
+        using internal::Binary;
+        scratch.clear();
+        Binary::putVarint(scratch, metadata.level);
+        Binary::putVarint(scratch, metadata.line);
+        Binary::putString(scratch, metadata.filename);
+        Binary::putString(scratch, metadata.tag);
+        const auto found = encoded.find(scratch);
+        if (found != encoded.end()) {
+            return found->second;
+        }
+        const unsigned long long id = writeSite(metadata, message);
+        encoded.emplace(scratch, id);
+        return id;
+    }
+    /**
+     * @brief Writes the call site of a log, under a new id, along with
+     *          its message and the types of its arguments, which later
+     *          logs of the site are stored against
+     * @param metadata: const Metadata&
+     * @param message: const std::string&
+     * @return unsigned long long
+     */
+    unsigned long long writeSite(const Metadata& metadata,
+                                 const std::string& message) {
+        using internal::Binary;
+        const unsigned long long id = templates.size();
+        templates.emplace_back();
+        Template& site = templates.back();
+        Binary::splitPieces(message, site.literals);
+        site.typed =
+            metadata.args && Binary::signature(*metadata.args, site.types);
+        buffer += Binary::SiteEntry;
+        Binary::putVarint(buffer, id);
+        Binary::putVarint(buffer, metadata.level);
+        Binary::putVarint(buffer, metadata.line);
+        Binary::putString(buffer, metadata.filename);
+        Binary::putString(buffer, metadata.tag);
+        Binary::putString(buffer, message);
+        if (!site.typed) {
+            Binary::putVarint(buffer, 0);
+            return id;
+        }
+        Binary::putVarint(buffer, site.types.size() + 1);
+        for (const Binary::Arg& arg : site.types) {
+            buffer += static_cast<char>(arg.type);
+            if (arg.type == internal::ArgBuffer::String) {
+                Binary::putString(buffer, arg.piece);
+            }
+        }
+        return id;
+    }
+    /**
+     * @brief Returns id of a field key, writing it first if new
+     * @param name: StringRef
+     * @return unsigned long long
+     */
+    unsigned long long key(StringRef name) {
+        using internal::Binary;
+        scratch.assign(name.data(), name.size());
+        const auto found = keys.find(scratch);
+        if (found != keys.end()) {
+            return found->second;
+        }
+        const unsigned long long id = keys.size();
+        keys.emplace(scratch, id);
+        buffer += Binary::KeyEntry;
+        Binary::putVarint(buffer, id);
+        Binary::putString(buffer, name);
+        return id;
+    }
+    std::ostream& os;
+    // a site & tag written so far, and its id
+    struct Cached {
+        const internal::Site* site;
+        std::string tag;
+        unsigned long long id;
+    };
+    // recently logged sites & tags, by address of the site
+    Cached cache[64] = {};
+    // ids of sites written so far, by address of the site
+    std::map<const internal::Site*, std::vector<Cached>> sites;
+    // ids of sites of logs made without the logging macros, keyed by
+    // their encoding
+    std::map<std::string, unsigned long long> encoded;
+    // what logs of a site are stored against, by id
+    struct Template {
+        std::vector<std::string> literals;
+        std::vector<internal::Binary::Arg> types;
+        bool typed = false;
+    };
+    std::vector<Template> templates;
+    // ids of field keys written so far
+    std::map<std::string, unsigned long long> keys;
+    long long last = 0;
+    // reused for every log
+    std::string scratch;
+    std::vector<unsigned long long> keyIds;
+    std::string buffer;
+};  // BinarySink
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Reads back logs written by BinarySink, one at a time
+ *        Metadata and message are valid until the next call to next
+ *        Timestamps are formatted in local time of the reader
+ * @usage R::BinaryDecoder decoder(fs);
+ *        while (decoder.next()) {
+ *            std::cout << R::JsonFormatter(decoder.metadata,
+ *                                          decoder.message);
+ *        }
+ */
+struct BinaryDecoder {
+    explicit BinaryDecoder(std::istream& is) : is(is) {
+        char magic[internal::Binary::magicSize];
+        valid = is.read(magic, sizeof(magic)) &&
+                std::equal(magic, magic + sizeof(magic),
+                           internal::Binary::magic());
+    }
+    R_INTERNAL_DISALLOW_COPY_ASSIGN(BinaryDecoder);
+    /**
+     * @brief Reads next log
+     * @return bool, false at end of input, or on malformed input
+     */
+    bool next() {
+        using internal::Binary;
+        while (valid) {
+            const int kind = is.get();
+            if (kind == EOF) {
+                return false;
+            }
+            if (kind == Binary::SiteEntry) {
+                valid = readSite();
+            } else if (kind == Binary::KeyEntry) {
+                valid = readKey();
+            } else if (kind == Binary::LogEntry) {
+                valid = readLog();
+                return valid;
+            } else {
+                valid = false;
+            }
+        }
+        return false;
+    }
+    // ------------------------------
+    struct SiteEntry {
+        Level level;
+        long line;
+        std::string filename;
+        std::string tag;
+        // what logs of the site are stored against
+        std::vector<std::string> literals;
+        std::vector<internal::Binary::Arg> types;
+        bool typed = false;
+    };
+    bool readSite() {
+        using internal::Binary;
+        using internal::ArgBuffer;
+        unsigned long long id, level, line, count;
+        SiteEntry site;
+        if (!Binary::getVarint(is, id) || !Binary::getVarint(is, level) ||
+            !Binary::getVarint(is, line) ||
+            !Binary::getString(is, site.filename) ||
+            !Binary::getString(is, site.tag) ||
+            !Binary::getString(is, message) ||
+            !Binary::getVarint(is, count) || id != sites.size() ||
+            level > Level::Off) {
+            return false;
+        }
+        Binary::splitPieces(message, site.literals);
+        site.typed = count > 0;
+        size_t strings = 0;
+        for (unsigned long long i = 1; i < count; ++i) {
+            const int type = is.get();
+            if (type == EOF || type == ArgBuffer::LongDouble ||
+                type > ArgBuffer::String ||
+                (type == ArgBuffer::String && ++strings > 64)) {
+                return false;
+            }
+            site.types.push_back({static_cast<ArgBuffer::Type>(type), {}});
+            if (type == ArgBuffer::String &&
+                !Binary::getString(is, site.types.back().piece)) {
+                return false;
+            }
+        }
+        site.level = static_cast<Level>(level);
+        site.line = static_cast<long>(line);
+        sites.push_back(std::move(site));
+        return true;
+    }
+    /**
+     * @brief Reads the message of a log of given site
+     */
+    bool readMessage(const SiteEntry& site) {
+        using internal::Binary;
+        switch (is.get()) {
+            case Binary::Args:
+                if (!site.typed ||
+                    !Binary::getArgs(is, site.types, args, text)) {
+                    return false;
+                }
+                message.clear();
+                args.render(message);
+                return true;
+            case Binary::Pieces:
+                return Binary::getPieces(is, site.literals, message);
+            case Binary::Text:
+                return Binary::getString(is, message);
+            default:
+                return false;
+        }
+    }
+    bool readKey() {
+        using internal::Binary;
+        unsigned long long id;
+        std::string key;
+        if (!Binary::getVarint(is, id) || id != keys.size() ||
+            !Binary::getString(is, key)) {
+            return false;
+        }
+        keys.push_back(std::move(key));
+        return true;
+    }
+    bool readLog() {
+        using internal::Binary;
+        unsigned long long id, suppressed, count;
+        long long delta;
+        if (!Binary::getVarint(is, id) || id >= sites.size() ||
+            !Binary::getSigned(is, delta) ||
+            !Binary::getVarint(is, suppressed) || !readMessage(sites[id]) ||
+            !Binary::getVarint(is, count)) {
+            return false;
+        }
+        fields.clear();
+        text.clear();
+        // offsets into text, bound once it stops growing
+        std::vector<std::pair<size_t, size_t>> strings;
+        std::string value;
+        for (unsigned long long i = 0; i < count; ++i) {
+            Field field;
+            unsigned long long key;
+            if (!Binary::getVarint(is, key) || key >= keys.size()) {
+                return false;
+            }
+            field.key = keys[key];
+            strings.emplace_back(0, 0);
+            const int type = is.get();
+            field.type = static_cast<Field::Type>(type);
+            bool read = true;
+            switch (type) {
+                case Field::Bool:
+                    field.boolean = is.get() > 0;
+                    read = bool(is);
+                    break;
+                case Field::Int:
+                    read = Binary::getSigned(is, field.integer);
+                    break;
+                case Field::UInt:
+                    read = Binary::getVarint(is, field.uinteger);
+                    break;
+                case Field::Double:
+                    read = Binary::getDouble(is, field.real);
+                    break;
+                case Field::String:
+                    read = Binary::getString(is, value);
+                    strings.back() = {text.size(), value.size()};
+                    text += value;
+                    break;
+                default:
+                    read = false;
+            }
+            if (!read) {
+                return false;
+            }
+            fields.push_back(field);
+        }
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].type == Field::String) {
+                fields[i].string =
+                    StringRef(&text[0] + strings[i].first, strings[i].second);
+            }
+        }
+        const SiteEntry& site = sites[id];
+        time += delta;
+        metadata = Metadata();
+        metadata.level = site.level;
+        metadata.filename = site.filename;
+        metadata.line = site.line;
+        metadata.time = time;
+        metadata.tag = site.tag;
+        metadata.suppressed = suppressed;
+        metadata.fields = Fields(fields.data(), fields.size());
+        return true;
+    }
+    // ------------------------------
+    std::istream& is;
+    bool valid;
+    std::vector<SiteEntry> sites;
+    std::vector<std::string> keys;
+    long long time = 0;
+    std::vector<Field> fields;
+    std::string text;
+    internal::ArgBuffer args;
+    // ------------------------------
+    Metadata metadata;
+    std::string message;
+};  // BinaryDecoder
+
+// -----------------------------------------------------------
+
 }  // namespace R
 
 // -----------------------------------------------------------
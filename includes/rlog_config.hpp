@@ -31,6 +31,125 @@
 
 // -----------------------------------------------------------
 
+/**
+ * @brief Default capacity of the async ring buffer, in logs
+ *        Must be a power of two
+ */
+#ifndef R_ASYNC_CAPACITY
+#define R_ASYNC_CAPACITY (8192)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Default capacity of each thread's buffer in per-thread async mode,
+ *          in logs
+ *        Must be a power of two
+ */
+#ifndef R_ASYNC_THREAD_CAPACITY
+#define R_ASYNC_THREAD_CAPACITY (1024)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Allows reusing a thread-local message buffer for every log
+ *        true: the buffer keeps its capacity from one log to the next
+ *        false: every log constructs its own stream
+ */
+#ifndef R_REUSE_THREAD_BUFFER
+#define R_REUSE_THREAD_BUFFER (true)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Bytes of message a log stream holds inline, before it
+ *          spills to the heap
+ */
+#ifndef R_STREAM_INLINE_SIZE
+#define R_STREAM_INLINE_SIZE (256)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Number of key / value fields a log holds inline, before it
+ *          spills to the heap
+ */
+#ifndef R_FIELDS_INLINE_COUNT
+#define R_FIELDS_INLINE_COUNT (4)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Allows deferring the conversion of streamed values to text
+ *        true: built-in types and strings are copied as binary arguments,
+ *          and formatted only when a Sink needs the message,
+ *          i.e. on the backend thread in async mode
+ *        false: values are formatted by an ostringstream as they are streamed
+ * @note In deferred mode, std::ostream manipulators taking arguments,
+ *         like std::setw, do not affect built-in types
+ */
+#ifndef R_DEFERRED_FORMAT
+#define R_DEFERRED_FORMAT (false)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Bytes of binary arguments a deferred log holds before it
+ *          allocates
+ */
+#ifndef R_DEFERRED_INLINE_SIZE
+#define R_DEFERRED_INLINE_SIZE (128)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Allows timing logs by the time stamp counter of the cpu
+ *        true: logs read the counter, a few nanoseconds, and convert it
+ *          to wall time by a calibration against the system clock
+ *        false: logs read the system clock
+ * @note Falls back to the system clock on cpus without an invariant
+ *         time stamp counter, and on other than x86
+ */
+#ifndef R_TSC_CLOCK
+#define R_TSC_CLOCK (false)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Lock of Serialized Sinks, and of changes to Sinks and levels
+ *        R_LOCK_RECURSIVE_MUTEX: std::recursive_mutex
+ *        R_LOCK_MUTEX: std::mutex
+ *        R_LOCK_SPIN: test-and-test-and-set spin lock with backoff,
+ *          for quick Sinks and few logging threads
+ * @note Sinks can log themselves with any of them
+ */
+#define R_LOCK_RECURSIVE_MUTEX (0)
+#define R_LOCK_MUTEX (1)
+#define R_LOCK_SPIN (2)
+#ifndef R_LOCK
+#define R_LOCK (R_LOCK_RECURSIVE_MUTEX)
+#endif
+
+// -----------------------------------------------------------
+
+/**
+ * @brief Removes all locking, when set to true
+ *        For programs that only ever log from a single thread
+ * @note Async mode and Confined Sinks must then not be used
+ */
+#ifndef R_SINGLE_THREADED
+#define R_SINGLE_THREADED (false)
+#endif
+
+// -----------------------------------------------------------
+
 #endif  // __R_LOG_CONFIG_HPP__
 
 // -----------------------------------------------------------
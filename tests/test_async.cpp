@@ -0,0 +1,262 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <future>
+#include <map>
+#include <string>
+#include <thread>
+
+// -------------------------------------------------------------------
+// async logging starts a backend thread, which R_SINGLE_THREADED rules out
+
+#if !R_SINGLE_THREADED
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct AsyncTest : Test {
+    AsyncTest() {
+        R::reset(R::Level::Info);
+        R::addSink(R_SINK_W_CAPTURE(m, s, this) {
+            lock_guard<mutex> lock(m_mutex);
+            m_threads.push_back(this_thread::get_id());
+            m_messages.push_back(s);
+            m_tags.push_back(m.tag);
+        });
+    }
+    virtual ~AsyncTest() override { R::reset(); }
+    mutex m_mutex;
+    vector<thread::id> m_threads;
+    vector<string> m_messages;
+    vector<string> m_tags;
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, basic) {
+    R::startAsync();
+    R_INFO("A") << "X" << 1;
+    R_WARNING("B") << "Y" << 2;
+    R::flush();
+    ASSERT_EQ(m_messages, vector<string>({"X1", "Y2"}));
+    EXPECT_EQ(m_tags, vector<string>({"A", "B"}));
+    // sinks ran on the backend thread
+    EXPECT_NE(m_threads[0], this_thread::get_id());
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, multithreaded) {
+    // tiny ring, so that producers regularly find it full
+    R::startAsync(8);
+    const int threads = 4;
+    const int logs = 2000;
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([t] {
+            for (int i = 0; i < logs; ++i) {
+                R_INFO(to_string(t)) << i;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    R::flush();
+    ASSERT_EQ(m_messages.size(), size_t(threads * logs));
+    // per producer, order is preserved
+    map<string, int> next;
+    for (size_t i = 0; i < m_messages.size(); ++i) {
+        EXPECT_EQ(m_messages[i], to_string(next[m_tags[i]]++));
+    }
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, stopDrains) {
+    R::startAsync();
+    for (int i = 0; i < 100; ++i) {
+        R_ERROR("") << i;
+    }
+    R::stopAsync();
+    EXPECT_EQ(m_messages.size(), 100u);
+    // back to synchronous
+    R_ERROR("") << "sync";
+    ASSERT_EQ(m_messages.size(), 101u);
+    EXPECT_EQ(m_threads.back(), this_thread::get_id());
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, logFromSink) {
+    R::addSink(R_SINK(m, s) {
+        if (m.tag == "outer") {
+            R_INFO("inner") << s;
+        }
+    });
+    R::startAsync();
+    R_INFO("outer") << "X";
+    R::flush();
+    EXPECT_EQ(m_tags, vector<string>({"outer", "inner"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, perThread) {
+    R::startAsync(R::AsyncMode::PerThread, 8);
+    const int threads = 4;
+    const int logs = 2000;
+    // short-lived threads, each one registering and handing back a buffer
+    for (int round = 0; round < 3; ++round) {
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([t] {
+                for (int i = 0; i < logs; ++i) {
+                    R_INFO(to_string(t)) << i;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    R::flush();
+    ASSERT_EQ(m_messages.size(), size_t(3 * threads * logs));
+    map<string, int> next;
+    for (size_t i = 0; i < m_messages.size(); ++i) {
+        EXPECT_EQ(m_messages[i], to_string(next[m_tags[i]]++ % logs));
+    }
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, perThreadMerge) {
+    promise<void> gate;
+    shared_future<void> opened(gate.get_future());
+    R::addSink(R_SINK_W_CAPTURE(m, s, opened) {
+        if (m.tag == "gate") {
+            opened.wait();
+        }
+    });
+    R::startAsync(R::AsyncMode::PerThread);
+    R_INFO("gate") << "";
+    // backend is now held up, so these pile up in separate buffers
+    for (int i = 0; i < 6; ++i) {
+        thread([i] { R_INFO("merge") << i; }).join();
+    }
+    gate.set_value();
+    R::flush();
+    EXPECT_EQ(m_messages, vector<string>({"", "0", "1", "2", "3", "4", "5"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, perThreadRestart) {
+    atomic<bool> done(false);
+    atomic<int> logged(0);
+    vector<thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&] {
+            while (!done) {
+                R_INFO("restart") << "";
+                ++logged;
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i) {
+        R::startAsync(R::AsyncMode::PerThread, 8);
+        this_thread::yield();
+        R::stopAsync();
+    }
+    done = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    // none lost in a buffer that a later session never drained
+    lock_guard<mutex> lock(m_mutex);
+    EXPECT_EQ(m_messages.size(), static_cast<size_t>(logged.load()));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, restartOtherMode) {
+    atomic<bool> done(false);
+    atomic<int> logged(0);
+    vector<thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&] {
+            while (!done) {
+                R_INFO("restart") << "";
+                ++logged;
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i) {
+        R::startAsync(i % 2 ? R::AsyncMode::PerThread : R::AsyncMode::Shared,
+                      8);
+        this_thread::yield();
+        R::stopAsync();
+    }
+    done = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    // none pushed to a queue of the other mode
+    lock_guard<mutex> lock(m_mutex);
+    EXPECT_EQ(m_messages.size(), static_cast<size_t>(logged.load()));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(AsyncTest, nested) {
+    for (R::AsyncMode mode : {R::AsyncMode::Shared, R::AsyncMode::PerThread}) {
+        R::reset(R::Level::Info);
+        vector<string> messages;
+        R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+            messages.push_back(s);
+            if (s == "add") {
+                R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+                    messages.push_back("added " + s);
+                });
+            } else if (s == "reset") {
+                // stops async mode from the backend thread
+                R::reset(R::Level::Info);
+            }
+        });
+        R::startAsync(mode, 8);
+        R_INFO("") << "add";
+        R_INFO("") << "log";
+        R_INFO("") << "reset";
+        R_INFO("") << "none";
+        R::flush();
+        EXPECT_EQ(messages,
+                  vector<string>(
+                      {"add", "log", "added log", "reset", "added reset"}));
+        // and it can be started again
+        R::startAsync(mode, 8);
+        R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); });
+        R_INFO("") << "again";
+        R::stopAsync();
+        EXPECT_EQ(messages.back(), "again");
+    }
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+#endif
+
+// -------------------------------------------------------------------
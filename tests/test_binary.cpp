@@ -0,0 +1,220 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct BinaryTest : Test {
+    BinaryTest() {
+        R::reset(R::Level::Info);
+        R::addSink(R_SINK_W_CAPTURE(m, s, this) {
+            m_text.push_back(m_smart(m, s));
+            m_json.push_back(R::JsonFormatter(m, s));
+        });
+    }
+    virtual ~BinaryTest() override { R::reset(); }
+    /**
+     * @brief Decodes a binary file, formatting every log like the sink
+     */
+    void decode(const string& filename,
+                vector<string>& text,
+                vector<string>& json) {
+        ifstream is(filename, ios::binary);
+        R::BinaryDecoder decoder(is);
+        ASSERT_TRUE(decoder.valid);
+        while (decoder.next()) {
+            text.push_back(m_smart(decoder.metadata, decoder.message));
+            json.push_back(R::JsonFormatter(decoder.metadata, decoder.message));
+        }
+        EXPECT_TRUE(decoder.valid);
+    }
+    const R::Formatter m_smart = R::makeSmartFormatter();
+    vector<string> m_text;
+    vector<string> m_json;
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(BinaryTest, roundtrip) {
+    const string filename = "outputs/binary_roundtrip.rlog";
+    {
+        ofstream os(filename, ios::binary);
+        R::BinarySink binary(os);
+        R::addSink(ref(binary));
+        for (int i = 0; i < 3; ++i) {
+            R_INFO("net") << "packet " << i;
+            R_WARNING("db")
+                    .kv("query", "select")
+                    .kv("rows", i - 1)
+                    .kv("ms", 0.25 * i)
+                    .kv("cached", i == 1)
+                    .kv("id", 1ull << 40)
+                << "slow \"query\"\n" << i;
+        }
+        R_ERROR("") << "";
+        for (int i = 0; i < 3; ++i) {
+            R_ERROR_EVERY_N("storm", 2) << "storm " << i;
+        }
+        R::reset(R::Level::Info);
+    }
+    vector<string> text, json;
+    decode(filename, text, json);
+    EXPECT_EQ(text.size(), 9u);
+    EXPECT_EQ(text, m_text);
+    EXPECT_EQ(json, m_json);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(BinaryTest, compact) {
+    const string filename = "outputs/binary_compact.rlog";
+    size_t textSize = 0;
+    {
+        ofstream os(filename, ios::binary);
+        R::BinarySink binary(os);
+        R::addSink(ref(binary));
+        for (int i = 0; i < 1000; ++i) {
+            R_INFO("net").kv("bytes", i * 10) << i;
+        }
+        R::reset(R::Level::Info);
+    }
+    for (const auto& line : m_text) {
+        textSize += line.size() + 1;
+    }
+    ifstream is(filename, ios::binary | ios::ate);
+    const size_t binarySize = static_cast<size_t>(is.tellg());
+    // sites and keys once, then only ids, deltas and values per log
+    EXPECT_LT(binarySize * 3, textSize);
+
+    vector<string> text, json;
+    decode(filename, text, json);
+    EXPECT_EQ(text, m_text);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(BinaryTest, pieces) {
+    const string filename = "outputs/binary_pieces.rlog";
+    const int count = 1000;
+    {
+        ofstream os(filename, ios::binary);
+        R::BinarySink binary(os);
+        R::addSink(ref(binary));
+        // the first log of a site is written along with the site
+        R_INFO("net") << "packet " << -1 << " of " << count;
+        const size_t start = static_cast<size_t>(os.tellp());
+        for (int i = 0; i < count; ++i) {
+            R_INFO("net") << "packet " << i << " of " << count;
+        }
+        const size_t size = static_cast<size_t>(os.tellp()) - start;
+        // site id, time delta, suppressed, encoding, numbers & fields,
+        // but not the literals of the message
+        cout << "bytes per log: " << double(size) / count << endl;
+        EXPECT_LT(size, count * 16u);
+
+        // logs whose literals or types differ from the first of their
+        // site are still read back the same
+        for (int i = 0; i < 8; ++i) {
+            R_INFO("mix") << (i % 2 ? "odd " : nullptr) << -i << ' '
+                          << 0.5 * i << ' ' << 1.5f << ' ' << (i % 3 == 0)
+                          << ' ' << string(i % 4, '0') << 7u << "x"
+                          << (1ull << 63);
+        }
+        R::reset(R::Level::Info);
+    }
+    vector<string> text, json;
+    decode(filename, text, json);
+    EXPECT_EQ(text.size(), 1009u);
+    EXPECT_EQ(text, m_text);
+    EXPECT_EQ(json, m_json);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(BinaryTest, sites) {
+    const string filename = "outputs/binary_sites.rlog";
+    {
+        ofstream os(filename, ios::binary);
+        R::BinarySink binary(os);
+        R::addSink(ref(binary));
+        // tags given at run time are told apart at the same site
+        for (int i = 0; i < 4; ++i) {
+            R_INFO(string(i % 2 ? "odd" : "even")) << i;
+        }
+        R::reset(R::Level::Info);
+        // as are logs made without the logging macros
+        for (const char* tag : {"a", "b", "a"}) {
+            const R::Metadata metadata(R::Level::Error, __FILE__, 1, tag);
+            binary(metadata, "direct");
+            m_text.push_back(m_smart(metadata, "direct"));
+        }
+    }
+    vector<string> text, json;
+    decode(filename, text, json);
+    EXPECT_EQ(text.size(), 7u);
+    EXPECT_EQ(text, m_text);
+}
+
+// -------------------------------------------------------------------
+
+TEST(BinaryDecoderTest, malformed) {
+    istringstream empty("");
+    EXPECT_FALSE(R::BinaryDecoder(empty).valid);
+
+    istringstream other("{\"json\": 1}");
+    EXPECT_FALSE(R::BinaryDecoder(other).valid);
+
+    // a log of a site that was never written
+    istringstream unknown(string("RLOG\x02L\x05", 7));
+    R::BinaryDecoder decoder(unknown);
+    EXPECT_TRUE(decoder.valid);
+    EXPECT_FALSE(decoder.next());
+    EXPECT_FALSE(decoder.valid);
+}
+
+// -------------------------------------------------------------------
+
+TEST(BinaryDecoderTest, corrupt) {
+    // a filename claiming to be far larger than the file
+    istringstream huge(string("RLOG\x02S\x00\x00\x01", 9) +
+                       string("\xff\xff\xff\xff\xff\xff\xff\x7f", 8));
+    R::BinaryDecoder decoder(huge);
+    EXPECT_TRUE(decoder.valid);
+    EXPECT_FALSE(decoder.next());
+    EXPECT_FALSE(decoder.valid);
+
+    // every truncation of a valid file ends decoding, without throwing
+    ostringstream os;
+    {
+        R::BinarySink binary(os);
+        const R::Metadata metadata(R::Level::Info, __FILE__, 1, "tag");
+        binary(metadata, "a message");
+        binary(metadata, "another message");
+    }
+    const string file = os.str();
+    for (size_t size = 0; size < file.size(); ++size) {
+        istringstream is(file.substr(0, size));
+        R::BinaryDecoder truncated(is);
+        int logs = 0;
+        while (truncated.next()) {
+            ++logs;
+        }
+        EXPECT_LT(logs, 2) << size;
+    }
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
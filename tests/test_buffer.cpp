@@ -0,0 +1,178 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <new>
+#include <set>
+
+// -------------------------------------------------------------------
+
+#if R_REUSE_THREAD_BUFFER && !R_DEFERRED_FORMAT
+
+// -------------------------------------------------------------------
+// counts heap allocations of the calling thread while counting is set,
+// replacing every form of global new & delete, so that they all pair
+// malloc with free
+
+static thread_local bool counting = false;
+static thread_local size_t allocations = 0;
+
+// gcc takes free inlined into a delete as mismatching the operator new of
+// the pointer, not seeing that the new here mallocs
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    if (counting) {
+        ++allocations;
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    if (counting) {
+        ++allocations;
+    }
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    ::operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    ::operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+
+void operator delete[](void* p, std::size_t) noexcept {
+    ::operator delete(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+#if R_REUSE_THREAD_BUFFER && !R_DEFERRED_FORMAT
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Returns heap allocations made by 100 calls of f
+ */
+template <typename F>
+size_t countAllocations(F f) {
+    allocations = 0;
+    counting = true;
+    for (int i = 0; i < 100; ++i) {
+        f();
+    }
+    counting = false;
+    return allocations;
+}
+
+// -------------------------------------------------------------------
+
+TEST(BufferTest, allocations) {
+    R::reset(R::Level::Info);
+    size_t total = 0;
+    set<const char*> buffers;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        total += s.size();
+        buffers.insert(s.data());
+    });
+
+    // well beyond the inline buffer, and small string optimisation
+    const string text(R_STREAM_INLINE_SIZE + 100, 'x');
+    const auto log = [&] { R_INFO("buffer") << text << 1; };
+
+    // warm up thread-local buffer, and register the call site
+    log();
+    const auto& pool = R::internal::LogStream::pool();
+    ASSERT_EQ(pool.streams.size(), 1u);
+    const size_t capacity = pool.streams[0]->heap.capacity();
+
+    const size_t reused = countAllocations(log);
+    // every message was written into the same, never regrown, buffer
+    EXPECT_EQ(buffers.size(), 1u);
+    EXPECT_EQ(pool.streams.size(), 1u);
+    EXPECT_EQ(pool.streams[0]->heap.capacity(), capacity);
+    EXPECT_EQ(total, 101u * (text.size() + 1));
+
+    const size_t streamed = countAllocations([&] {
+        ostringstream os;
+        os << text << 1;
+        total += os.str().size();
+    });
+    cout << "allocations per 100 logs, reused buffer: " << reused
+         << ", ostringstream: " << streamed << endl;
+    EXPECT_EQ(reused, 0u);
+    EXPECT_GT(streamed, 0u);
+
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+
+TEST(BufferTest, nested) {
+    R::reset(R::Level::Info);
+    vector<string> messages;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        messages.push_back(s);
+        if (m.tag == "outer") {
+            R_INFO("inner") << "from sink";
+        }
+    });
+
+    R_INFO("outer") << hex << 255 << " " << [] {
+        // logs while the outer log is being streamed
+        R_INFO("inner") << "while streaming";
+        return 1;
+    }();
+    R_INFO("") << 255;
+
+    EXPECT_EQ(messages,
+              vector<string>(
+                  {"while streaming", "ff 1", "from sink", "255"}));
+
+    R::reset();
+}
+
+#endif
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
@@ -0,0 +1,106 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// -------------------------------------------------------------------
+// << operator declared at global scope, for a type of another namespace
+
+namespace deferred {
+struct Shape {
+    std::string name;
+};
+}  // namespace deferred
+
+std::ostream& operator<<(std::ostream& os, const deferred::Shape& s) {
+    return os << '[' << s.name << ']';
+}
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+string render(const R::internal::ArgStream& stream) {
+    string result;
+    stream.args.render(result);
+    return result;
+}
+
+// -------------------------------------------------------------------
+
+struct Point {
+    int x;
+    int y;
+};
+
+ostream& operator<<(ostream& os, const Point& p) {
+    return os << '(' << p.x << ',' << p.y << ')';
+}
+
+// -------------------------------------------------------------------
+
+TEST(DeferredTest, builtins) {
+    R::internal::ArgStream stream;
+    ostringstream expected;
+    const string text = "text";
+    stream << "X" << 1 << 4.5 << -7L << 42u << 1e20 << 0.1f << true << 'c'
+           << short(-3) << 123456789012LL << text << endl;
+    expected << "X" << 1 << 4.5 << -7L << 42u << 1e20 << 0.1f << true << 'c'
+             << short(-3) << 123456789012LL << text << endl;
+    EXPECT_FALSE(stream.args.replay);
+    EXPECT_EQ(render(stream), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(DeferredTest, replay) {
+    R::internal::ArgStream stream;
+    ostringstream expected;
+    int i = 0;
+    stream << hex << 255 << dec << " " << boolalpha << false << " " << &i;
+    expected << hex << 255 << dec << " " << boolalpha << false << " " << &i;
+    EXPECT_TRUE(stream.args.replay);
+    EXPECT_EQ(render(stream), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(DeferredTest, usertype) {
+    R::internal::ArgStream stream;
+    stream << "at " << Point{1, 2};
+    EXPECT_EQ(render(stream), "at (1,2)");
+}
+
+// -------------------------------------------------------------------
+
+TEST(DeferredTest, globalOperator) {
+    R::internal::ArgStream stream;
+    stream << "at " << deferred::Shape{"circle"};
+    EXPECT_EQ(render(stream), "at [circle]");
+}
+
+// -------------------------------------------------------------------
+
+TEST(DeferredTest, spill) {
+    R::internal::ArgStream stream;
+    const string large(3 * R_DEFERRED_INLINE_SIZE, 'x');
+    stream << 1 << large << 2;
+    R::internal::ArgBuffer moved(std::move(stream.args));
+    EXPECT_TRUE(stream.args.empty());
+    string result;
+    moved.render(result);
+    EXPECT_EQ(result, "1" + large + "2");
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
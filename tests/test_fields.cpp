@@ -0,0 +1,163 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// -------------------------------------------------------------------
+// << operator declared at global scope, for a type of another namespace
+
+namespace fields {
+struct Shape {
+    std::string name;
+};
+}  // namespace fields
+
+std::ostream& operator<<(std::ostream& os, const fields::Shape& s) {
+    return os << '[' << s.name << ']';
+}
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct Point {
+    int x;
+    int y;
+};
+
+ostream& operator<<(ostream& os, const Point& p) {
+    return os << '(' << p.x << ',' << p.y << ')';
+}
+
+// -------------------------------------------------------------------
+
+struct FieldsTest : Test {
+    FieldsTest() {
+        R::reset(R::Level::Info);
+        R::addSink(R_SINK_W_CAPTURE(m, s, this) {
+            m_messages.push_back(s);
+            string fields;
+            R::internal::json_fields(fields, m.fields);
+            m_fields.push_back(fields);
+        });
+    }
+    virtual ~FieldsTest() override { R::reset(); }
+    vector<string> m_messages;
+    vector<string> m_fields;
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(FieldsTest, types) {
+    const string name = "x\"y";
+    R_INFO("req")
+            .kv("user", 42)
+            .kv("latency_us", 12.5)
+            .kv("ok", true)
+            .kv("big", 18446744073709551615ull)
+            .kv("name", name)
+        << "done";
+    R_WARNING("req").kv("point", Point{1, 2}).kv("inf", 1.0 / 0.0)
+        << "p";
+    ASSERT_EQ(m_messages, vector<string>({"done", "p"}));
+    EXPECT_EQ(m_fields[0],
+              "{\"user\": 42, \"latency_us\": 12.5, \"ok\": true, "
+              "\"big\": 18446744073709551615, \"name\": \"x\\\"y\"}");
+    EXPECT_EQ(m_fields[1], "{\"point\": \"(1,2)\", \"inf\": null}");
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(FieldsTest, globalOperator) {
+    R_INFO("req").kv("shape", fields::Shape{"circle"}) << "s";
+    ASSERT_EQ(m_fields.size(), 1u);
+    EXPECT_EQ(m_fields[0], "{\"shape\": \"[circle]\"}");
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(FieldsTest, metadata) {
+    vector<R::Field::Type> types;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        for (const auto& field : m.fields) {
+            types.push_back(field.type);
+        }
+        const R::Field* user = m.fields.find("user");
+        ASSERT_NE(user, nullptr);
+        EXPECT_EQ(user->integer, -3);
+        EXPECT_EQ(m.fields.find("none"), nullptr);
+    });
+    R_INFO("req").kv("user", -3).kv("id", 7u).kv("c", 'c') << "";
+    EXPECT_EQ(types,
+              vector<R::Field::Type>(
+                  {R::Field::Int, R::Field::UInt, R::Field::String}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(FieldsTest, copies) {
+    // temporaries, beyond inline count, and beyond small strings
+    auto key = [](int i) { return "key_with_a_long_name_" + to_string(i); };
+    auto value = [](int i) { return string(20, char('a' + i)); };
+    for (int round = 0; round < 2; ++round) {
+        R_INFO("req")
+                .kv(key(0), value(0))
+                .kv(key(1), value(1))
+                .kv(key(2), value(2))
+                .kv(key(3), value(3))
+                .kv(key(4), value(4))
+                .kv(key(5), value(5))
+            << round;
+    }
+    ASSERT_EQ(m_fields.size(), 2u);
+    EXPECT_EQ(m_fields[0], m_fields[1]);
+    EXPECT_THAT(m_fields[0],
+                StartsWith("{\"key_with_a_long_name_0\": "
+                           "\"aaaaaaaaaaaaaaaaaaaa\", "));
+    EXPECT_THAT(m_fields[0],
+                EndsWith("\"key_with_a_long_name_5\": "
+                         "\"ffffffffffffffffffff\"}"));
+}
+
+// -------------------------------------------------------------------
+
+// async logging starts a backend thread, which R_SINGLE_THREADED rules out
+#if !R_SINGLE_THREADED
+
+TEST_F(FieldsTest, async) {
+    R::startAsync();
+    for (int i = 0; i < 3; ++i) {
+        R_INFO("req").kv("index", i).kv(string("name"), to_string(i)) << i;
+    }
+    R::flush();
+    EXPECT_EQ(m_fields, vector<string>({"{\"index\": 0, \"name\": \"0\"}",
+                                        "{\"index\": 1, \"name\": \"1\"}",
+                                        "{\"index\": 2, \"name\": \"2\"}"}));
+}
+
+#endif
+
+// -------------------------------------------------------------------
+
+TEST_F(FieldsTest, json) {
+    const R::Formatter formatter = R::JsonFormatter;
+    string json;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { json = formatter(m, s); });
+    R_INFO("req").kv("user", 42) << "done";
+    EXPECT_THAT(json, HasSubstr("\"fields\": {\"user\": 42},"));
+    R_INFO("req") << "none";
+    EXPECT_THAT(json, HasSubstr("\"fields\": {},"));
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
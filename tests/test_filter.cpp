@@ -36,6 +36,125 @@ TEST(FilterTest, basic) {
 
 // -------------------------------------------------------------------
 
+TEST(LevelTest, tags) {
+    std::vector<std::string> messages;
+    R::reset(R::Level::Warning);
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); });
+
+    R::setLevel("net", R::Level::Info);
+    R::setLevel("db", R::Level::Error);
+    EXPECT_EQ(R::level(), R::Level::Warning);
+    EXPECT_EQ(R::level("net"), R::Level::Info);
+    EXPECT_EQ(R::level("other"), R::Level::Warning);
+
+    const std::string net = "net";
+    for (int i = 0; i < 2; ++i) {
+        // same sites, logged before and after a level change
+        R_INFO("net") << "net " << i;
+        R_INFO(net) << "dynamic " << i;
+        R_INFO("db") << "db " << i;
+        R_WARNING("db") << "db " << i;
+        R_WARNING("other") << "other " << i;
+        R::setLevel("db", R::Level::Info);
+        R::setLevel(R::Level::Error);
+    }
+    EXPECT_EQ(messages, std::vector<std::string>({"net 0", "dynamic 0",
+                                                  "other 0", "net 1",
+                                                  "dynamic 1", "db 1",
+                                                  "db 1"}));
+
+    R::reset(R::Level::Warning);
+    EXPECT_EQ(R::level("net"), R::Level::Warning);
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+
+TEST(LevelTest, dynamicTags) {
+    std::vector<std::string> messages;
+    R::reset(R::Level::Info);
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); });
+    R::setLevel("db", R::Level::Error);
+
+    // one site, and one string, with changing content
+    std::string tag;
+    const auto log = [&](const char* text) {
+        tag = text;
+        R_INFO(tag) << tag;
+    };
+    log("net");
+    log("db");
+    log("net");
+    log("db");
+    R::setLevel("net", R::Level::Error);
+    R::setLevel("db", R::Level::Info);
+    log("net");
+    log("db");
+    EXPECT_EQ(messages, std::vector<std::string>({"net", "net", "db"}));
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+
+TEST(LevelTest, arrayTags) {
+    std::vector<std::string> messages;
+    R::reset(R::Level::Info);
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(m.tag); });
+    R::setLevel("db", R::Level::Error);
+
+    // one site, and one array, with changing content
+    char buf[8];
+    const auto log = [&](const char* text) {
+        std::strcpy(buf, text);
+        R_INFO(buf) << "";
+    };
+    log("net");
+    log("db");
+    log("net");
+    R::setLevel("net", R::Level::Error);
+    R::setLevel("db", R::Level::Info);
+    log("db");
+    log("net");
+    EXPECT_EQ(messages, std::vector<std::string>({"net", "net", "db"}));
+
+    // one site, and const arrays at different addresses
+    messages.clear();
+    const auto logArray = [&](const char(&tag)[4]) { R_INFO(tag) << ""; };
+    static const char net[] = "net";
+    static const char dbs[] = "dbs";
+    for (int i = 0; i < 2; ++i) {
+        logArray(net);
+        logArray(dbs);
+        R::setLevel("net", R::Level::Info);
+        R::setLevel("dbs", R::Level::Error);
+    }
+    EXPECT_EQ(messages, std::vector<std::string>({"dbs", "net"}));
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+
+TEST(LevelTest, concurrentReset) {
+    R::reset(R::Level::Off);
+    std::atomic<bool> done(false);
+    std::thread logger([&] {
+        while (!done) {
+            R_WARNING("level") << "maybe";
+        }
+    });
+    // changing the level while another thread logs is race-free
+    for (int i = 0; i < 1000; ++i) {
+        R::reset(i % 2 ? R::Level::Warning : R::Level::Off);
+    }
+    done = true;
+    logger.join();
+    EXPECT_EQ(R::level(), R::Level::Warning);
+    R::reset();
+    EXPECT_EQ(R::level(), R::Level::Info);
+}
+
+// -------------------------------------------------------------------
+
 }  // namespace
 
 // -------------------------------------------------------------------
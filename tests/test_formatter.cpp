@@ -44,6 +44,122 @@ TEST(FormatterTest, basic) {
 
 // -------------------------------------------------------------------
 
+TEST(FormatterTest, smart) {
+    R::Metadata metadata(R::Level::Error, "file.cpp", 42);
+    metadata.tag = "tag";
+    const auto format = [&](const std::string& format,
+                            const std::string& message) {
+        return R::makeSmartFormatter(format)(metadata, message);
+    };
+    EXPECT_EQ(format("#level #tag #filename:#line #fields #message", "m"),
+              "Error #tag file.cpp:42 {} m");
+    // every occurrence, and unknown ones left as they are
+    EXPECT_EQ(format("#line-#line #lines # ## #unknown#", ""),
+              "42-42 42s # ## #unknown#");
+    // never those within the message
+    EXPECT_EQ(format("#message #level", "#level #line"),
+              "#level #line Error");
+    EXPECT_EQ(format("", "m"), "");
+    EXPECT_EQ(format("no fields", "m"), "no fields");
+    metadata.tag = "";
+    EXPECT_EQ(format("[#tag]", ""), "[]");
+}
+
+// -------------------------------------------------------------------
+
+TEST(FormatterTest, compiled) {
+    R::Metadata metadata(R::Level::Warning, "file.cpp", 7, "tag");
+    const std::string message = "#message #line";
+    // same as parsed at run time
+    const auto same = [&](const R::Formatter& compiled, const char* format) {
+        EXPECT_EQ(compiled(metadata, message),
+                  R::internal::SmartFormat(format)(metadata, message))
+            << format;
+    };
+    same(R_SMART_FORMAT(R::defaultSmartFormat), R::defaultSmartFormat);
+    same(R_SMART_FORMAT("#level #tag #filename:#line #fields #message"),
+         "#level #tag #filename:#line #fields #message");
+    same(R_SMART_FORMAT("#line-#line #lines # ## #unknown#"),
+         "#line-#line #lines # ## #unknown#");
+    same(R_SMART_FORMAT(""), "");
+    metadata.tag = "";
+    same(R_SMART_FORMAT("[#tag]"), "[#tag]");
+
+    // fields are in the type
+    using Token = R::internal::SmartFormat::Token;
+    using Expected = R::internal::StaticFormat<
+        R::internal::StaticField<Token::Line>,
+        R::internal::StaticText<':', ' '>,
+        R::internal::StaticField<Token::Message>>;
+    EXPECT_TRUE((std::is_same<decltype(R_SMART_FORMAT("#line: #message")),
+                              Expected>()));
+}
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Escapes a character at a time, for reference
+ */
+std::string escaped(const std::string& text) {
+    std::string out;
+    for (const char c : text) {
+        char buffer[8];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+TEST(FormatterTest, escape) {
+    const auto escape = [](const std::string& text) {
+        std::string out;
+        R::internal::json_escape(out, text);
+        return out;
+    };
+    EXPECT_EQ(escape("say \"hi\"\n"), "say \\\"hi\\\"\\n");
+    EXPECT_EQ(escape(std::string("\0\x1f\x7f\xc3\xa9", 5)),
+              "\\u0000\\u001f\x7f\xc3\xa9");
+    // special characters at every position of, and across, vectors
+    const char specials[] = {'"', '\\', '\n', '\x01', '\x1f'};
+    for (size_t size = 0; size < 80; ++size) {
+        for (size_t at = 0; at < size; ++at) {
+            for (const char special : specials) {
+                std::string text(size, 'a');
+                text[at] = special;
+                // utf-8 bytes are not special, though negative as char
+                text[size - 1 - at] = static_cast<char>(0xe9);
+                ASSERT_EQ(escape(text), escaped(text)) << size << " " << at;
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------
+
+TEST(FormatterTest, json) {
+    R::Metadata metadata(R::Level::Info, "a\"b.cpp", 1, "t\\g");
+    const std::string json = R::JsonFormatter(metadata, "XYZ\n\"quoted\"");
+    EXPECT_THAT(json, HasSubstr("\"tag\": \"#t\\\\g\","));
+    EXPECT_THAT(json, HasSubstr("\"filename\": \"a\\\"b.cpp\","));
+    EXPECT_THAT(json,
+                HasSubstr("\"message\": \"XYZ\\n\\\"quoted\\\"\""));
+}
+
+// -------------------------------------------------------------------
+
 }  // namespace
 
 // -------------------------------------------------------------------
@@ -0,0 +1,163 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <set>
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct LimitTest : Test {
+    LimitTest() {
+        R::reset(R::Level::Info);
+        R::addSink(R_SINK_W_CAPTURE(m, s, this) {
+            m_messages.push_back(s);
+            m_suppressed.push_back(m.suppressed);
+        });
+    }
+    virtual ~LimitTest() override { R::reset(); }
+    vector<string> m_messages;
+    vector<unsigned long long> m_suppressed;
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, everyN) {
+    int evaluated = 0;
+    for (int i = 0; i < 10; ++i) {
+        R_WARNING_EVERY_N("A", 3) << i << [&] { return ++evaluated; }();
+    }
+    EXPECT_EQ(m_messages, vector<string>({"01", "32", "63", "94"}));
+    EXPECT_EQ(m_suppressed, vector<unsigned long long>({0, 2, 2, 2}));
+    // suppressed logs never evaluate their streamed expression
+    EXPECT_EQ(evaluated, 4);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, firstN) {
+    for (int i = 0; i < 10; ++i) {
+        R_ERROR_FIRST_N("A", 2) << i;
+    }
+    EXPECT_EQ(m_messages, vector<string>({"0", "1"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, everyMs) {
+    // long enough for the first logs to fall within one period even on a
+    // loaded host, while sleeping a whole period always ends it
+    auto log = [](int i) { R_INFO_EVERY_MS("A", 300) << i; };
+    for (int i = 0; i < 5; ++i) {
+        log(i);
+    }
+    this_thread::sleep_for(chrono::milliseconds(300));
+    log(5);
+    EXPECT_EQ(m_messages, vector<string>({"0", "5"}));
+    EXPECT_EQ(m_suppressed, vector<unsigned long long>({0, 4}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, filteredByLevel) {
+    R::setLevel(R::Level::Error);
+    for (int i = 0; i < 5; ++i) {
+        // not counted as suppressed, when filtered by level
+        R_WARNING_EVERY_N("A", 2) << i;
+    }
+    EXPECT_TRUE(m_messages.empty());
+    R::setLevel(R::Level::Info);
+    int i = 0;
+    if (true)
+        R_INFO_EVERY_N("A", 2) << i;
+    else
+        ++i;
+    EXPECT_EQ(m_messages, vector<string>({"0"}));
+    EXPECT_EQ(m_suppressed, vector<unsigned long long>({0}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, conditional) {
+    int evaluated = 0;
+    auto condition = [&](bool value) {
+        ++evaluated;
+        return value;
+    };
+    for (int i = 0; i < 4; ++i) {
+        R_INFO_IF(condition(i % 2 == 0), "A") << i;
+    }
+    R::setLevel(R::Level::Error);
+    // filtered by level, before evaluating the condition
+    R_WARNING_IF(condition(true), "A") << "never";
+    R_ERROR_IF(condition(false), "A") << "never";
+    if (evaluated > 0)
+        R_ERROR_IF(condition(true), "A") << "last";
+    else
+        ADD_FAILURE();
+    EXPECT_EQ(m_messages, vector<string>({"0", "2", "last"}));
+    EXPECT_EQ(evaluated, 6);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, sampled) {
+    int evaluated = 0;
+    for (int i = 0; i < 100; ++i) {
+        R_INFO_SAMPLED("A", 0.0) << [&] { return ++evaluated; }();
+        R_WARNING_SAMPLED("A", 1.0) << "all";
+    }
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_EQ(m_messages.size(), 100u);
+
+    m_messages.clear();
+    for (int i = 0; i < 10000; ++i) {
+        R_ERROR_SAMPLED("A", 0.25) << i;
+    }
+    EXPECT_GT(m_messages.size(), 2000u);
+    EXPECT_LT(m_messages.size(), 3000u);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(LimitTest, sampledBy) {
+    // every log of a kept key is kept, and none of a dropped one
+    set<string> kept;
+    for (int i = 0; i < 1000; ++i) {
+        const string key = "request-" + to_string(i);
+        for (int j = 0; j < 3; ++j) {
+            R_INFO_SAMPLED_BY("A", 0.1, key) << key;
+        }
+        if (R::internal::Sampler::keep(0.1, key)) {
+            kept.insert(key);
+        }
+    }
+    EXPECT_EQ(m_messages.size(), 3 * kept.size());
+    for (const auto& message : m_messages) {
+        EXPECT_EQ(kept.count(message), 1u);
+    }
+    EXPECT_GT(kept.size(), 50u);
+    EXPECT_LT(kept.size(), 150u);
+
+    m_messages.clear();
+    for (int i = 0; i < 1000; ++i) {
+        R_WARNING_SAMPLED_BY("A", 0.5, i) << i;
+    }
+    EXPECT_GT(m_messages.size(), 400u);
+    EXPECT_LT(m_messages.size(), 600u);
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
@@ -0,0 +1,85 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct PipeTest : Test {
+    PipeTest() { R::reset(R::Level::Info); }
+    virtual ~PipeTest() override { R::reset(); }
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(PipeTest, stages) {
+    vector<string> messages;
+    const auto errorsOnly = R_FILTER(m, s) {
+        return m.level == R::Level::Error;
+    };
+    const auto tagged = R_FORMATTER(m, s) { return m.tag + ": " + s; };
+    const auto brackets = R_FORMATTER(m, s) { return "[" + s + "]"; };
+    R::addSink(R::pipe(errorsOnly, tagged, brackets,
+                       R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); }));
+    R_INFO("a") << "skipped";
+    R_ERROR("b") << "passed";
+    EXPECT_EQ(messages, vector<string>({"[b: passed]"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PipeTest, types) {
+    auto formatter = R_FORMATTER(m, s) { return s; };
+    auto sink = R_SINK(m, s){};
+    const auto piped = R::pipe(formatter, sink);
+    // no std::function in between
+    EXPECT_TRUE((is_same<decltype(piped.stage), decltype(formatter)>()));
+    EXPECT_TRUE((is_same<decltype(piped.next), decltype(sink)>()));
+    // still usable as, or with, std::function ones
+    const R::Sink wrapped = R::pipe(R::Formatter(formatter), R::Sink(sink));
+    wrapped(R::Metadata(R::Level::Info, __FILE__, __LINE__), "");
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PipeTest, references) {
+    struct Counter {
+        R_SINK_OPERATOR(m, s) { ++count; }
+        int count = 0;
+    } counter;
+    // copies of a pipe share a sink passed by reference
+    R::addSink(R::pipe(R_FILTER(m, s) { return true; }, ref(counter)));
+    R::addSink(R::pipe(R_FILTER(m, s) { return false; }, ref(counter)));
+    R_INFO("") << "log";
+    EXPECT_EQ(counter.count, 1);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PipeTest, logger) {
+    vector<string> first, second;
+    auto logger = R::makeLogger(
+        R::pipe(R_FORMATTER(m, s) { return "1 " + s; },
+                R_SINK_W_CAPTURE(m, s, &) { first.push_back(s); }),
+        R_SINK_W_CAPTURE(m, s, &) { second.push_back(s); });
+    R::addSink(ref(logger));
+    R_INFO("") << "log";
+    EXPECT_EQ(first, vector<string>({"1 log"}));
+    EXPECT_EQ(second, vector<string>({"log"}));
+    EXPECT_EQ(tuple_size<decltype(logger.sinks)>::value, 2u);
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
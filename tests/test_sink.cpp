@@ -32,7 +32,7 @@ struct SinkTest : Test {
             m_mocksink.level(m.level);
             m_mocksink.filename(m.filename);
             m_mocksink.line(m.line);
-            m_mocksink.timestamp(m.timestamp);
+            m_mocksink.timestamp(m.timestamp());
             m_mocksink.tag(m.tag);
             m_mocksink.message(s);
         });
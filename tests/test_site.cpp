@@ -0,0 +1,142 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct SiteTest : Test {
+    SiteTest() {
+        R::reset(R::Level::Info);
+        R::addSink(R_SINK_W_CAPTURE(m, s, this) { m_metadata.push_back(m); });
+    }
+    virtual ~SiteTest() override { R::reset(); }
+    vector<R::Metadata> m_metadata;
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(SiteTest, shared) {
+    for (int i = 0; i < 2; ++i) {
+        R_INFO("A") << i;
+    }
+    R_INFO("A") << 2;
+    ASSERT_EQ(m_metadata.size(), 3u);
+    ASSERT_NE(m_metadata[0].site, nullptr);
+    // same call site, same descriptor
+    EXPECT_EQ(m_metadata[0].site, m_metadata[1].site);
+    EXPECT_NE(m_metadata[0].site, m_metadata[2].site);
+    EXPECT_EQ(m_metadata[0].filename, "test_site.cpp");
+    EXPECT_EQ(m_metadata[0].filename.data(), m_metadata[1].filename.data());
+    EXPECT_EQ(m_metadata[0].line, m_metadata[2].line - 2);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(SiteTest, registry) {
+    vector<string> messages;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); });
+    R::setLevel(R::Level::Warning);
+    const long first = __LINE__ + 2;
+    auto logAll = [] {
+        R_INFO("net.rx") << "rx";
+        R_INFO("net.tx") << "tx";
+        R_WARNING("db") << "db";
+    };
+    // the registry is global, so only look at sites above
+    auto here = [&] {
+        return R::sites().file("test_site.cpp").lines(first, first + 2);
+    };
+
+    logAll();
+    // filtered by global level, before registering
+    EXPECT_EQ(here().list().size(), 1u);
+
+    // applies to sites registered later too
+    EXPECT_EQ(here().tag("net.r?").enable(), 0u);
+    logAll();
+    EXPECT_EQ(here().list().size(), 3u);
+    EXPECT_EQ(here().tag("net*").list().size(), 2u);
+
+    EXPECT_EQ(R::sites()
+                  .file("*site.cpp")
+                  .lines(first + 2, first + 2)
+                  .disable(),
+              1u);
+    logAll();
+
+    EXPECT_EQ(here().restore(), 3u);
+    logAll();
+
+    EXPECT_EQ(messages, vector<string>({"db", "rx", "db", "rx", "db"}));
+
+    EXPECT_EQ(here().tag("db").disable(), 1u);
+    EXPECT_EQ(here().tag("db").list()[0].state, R::SiteState::Disabled);
+    R::reset(R::Level::Warning);
+    EXPECT_EQ(here().tag("db").list()[0].state, R::SiteState::ByLevel);
+}
+
+// -------------------------------------------------------------------
+
+TEST(GlobTest, basic) {
+    EXPECT_TRUE(R::internal::glob("*", ""));
+    EXPECT_TRUE(R::internal::glob("net*", "net.rx"));
+    EXPECT_TRUE(R::internal::glob("*.c?p", "a.cpp"));
+    EXPECT_TRUE(R::internal::glob("a*b*c", "aXbYbZc"));
+    EXPECT_FALSE(R::internal::glob("a*b*c", "aXbYbZ"));
+    EXPECT_FALSE(R::internal::glob("net", "net.rx"));
+    EXPECT_FALSE(R::internal::glob("?", ""));
+}
+
+// -------------------------------------------------------------------
+
+TEST(StringRefTest, basic) {
+    const string text = "abc";
+    R::StringRef ref(text);
+    EXPECT_EQ(ref.data(), text.data());
+    EXPECT_TRUE(ref == "abc");
+    EXPECT_TRUE(ref != "abd");
+    EXPECT_EQ(string("#") + ref, "#abc");
+    EXPECT_EQ(ref + "!", "abc!");
+    string converted = ref;
+    EXPECT_EQ(converted, text);
+    EXPECT_EQ(R::internal::basename("/a/b\\c.cpp"), "c.cpp");
+    EXPECT_EQ(R::internal::basename("c.cpp"), "c.cpp");
+}
+
+// -------------------------------------------------------------------
+
+TEST(BasenameTest, compiletime) {
+    static_assert(R::internal::basename("/a/b/c.cpp", 10).size() == 5, "");
+    static_assert(R::internal::basename("c.cpp", 5).size() == 5, "");
+    static_assert(R::internal::basename("a\\", 2).empty(), "");
+    static_assert(R_INTERNAL_FILENAME.size() == sizeof("test_site.cpp") - 1,
+                  "");
+    // long paths stay well within constexpr recursion limits
+    static constexpr char path[] =
+        "/a/very/deep/build/tree/a/very/deep/build/tree/a/very/deep/build/"
+        "tree/a/very/deep/build/tree/a/very/deep/build/tree/a/very/deep/"
+        "build/tree/a/very/deep/build/tree/a/very/deep/build/tree/a/very/"
+        "deep/build/tree/a/very/deep/build/tree/a/very/deep/build/tree/a/"
+        "very/deep/build/tree/a/very/deep/build/tree/a/very/deep/build/"
+        "tree/a/very/deep/build/tree/a/very/deep/build/tree/a/very/deep/"
+        "build/tree/a/very/deep/build/tree/a/very/deep/build/tree/x.cpp";
+    static_assert(
+        R::internal::basename(path, sizeof(path) - 1).size() == 5, "");
+    EXPECT_EQ(R::internal::basename(path, sizeof(path) - 1), "x.cpp");
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
@@ -0,0 +1,337 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <future>
+#include <set>
+#include <thread>
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+// these log from several threads, which R_SINGLE_THREADED rules out
+
+#if !R_SINGLE_THREADED
+
+// -------------------------------------------------------------------
+
+TEST(StoreTest, addWhileLogging) {
+    R::reset(R::Level::Info);
+    promise<void> entered, release;
+    shared_future<void> released(release.get_future());
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        if (s == "slow") {
+            entered.set_value();
+            released.wait();
+        }
+    });
+    thread slow([] { R_INFO("") << "slow"; });
+    entered.get_future().wait();
+
+    // a log in a sink does not block adding another
+    vector<string> messages;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); });
+
+    release.set_value();
+    slow.join();
+    R_INFO("") << "next";
+    R::reset();
+    EXPECT_EQ(messages, vector<string>({"next"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST(StoreTest, resetWhileLogging) {
+    R::reset(R::Level::Info);
+    atomic<bool> done(false);
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            while (!done) {
+                R_INFO("") << "log";
+            }
+        });
+    }
+    for (int i = 0; i < 20; ++i) {
+        auto count = make_shared<atomic<int>>(0);
+        R::addSink(R_SINK_W_CAPTURE(m, s, count) { ++*count; });
+        R::addSink(R_SINK_W_CAPTURE(m, s, count) { ++*count; });
+        this_thread::yield();
+        R::reset(R::Level::Info);
+        // removed sinks are never called once reset returns
+        const int after = *count;
+        this_thread::yield();
+        EXPECT_EQ(*count, after);
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+
+#endif
+
+// -------------------------------------------------------------------
+
+TEST(StoreTest, addFreesReplaced) {
+    R::reset(R::Level::Info);
+    auto& store = R::internal::Store::instance();
+    size_t most = 0;
+    for (int i = 0; i < 100; ++i) {
+        R::addSink(R_SINK(m, s){});
+        most = max(most, store.retired.size());
+    }
+    // none kept until reset, as no log was reading them
+    EXPECT_EQ(most, 0u);
+
+    // but those a log might be reading are
+    R::addSink(R_SINK(m, s) {
+        if (s == "add") {
+            R::addSink(R_SINK(m, s){});
+            R::addSink(R_SINK(m, s){});
+        }
+    });
+    R_INFO("") << "add";
+    EXPECT_EQ(store.retired.size(), 2u);
+    R::addSink(R_SINK(m, s){});
+    EXPECT_EQ(store.retired.size(), 0u);
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+
+TEST(StoreTest, nested) {
+    R::reset(R::Level::Info);
+    vector<string> messages;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        messages.push_back(s);
+        if (s == "add") {
+            R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+                messages.push_back("added " + s);
+            });
+        } else if (s == "reset") {
+            R::reset(R::Level::Info);
+        }
+    });
+    R_INFO("") << "add";
+    R_INFO("") << "log";
+    R_INFO("") << "reset";
+    R_INFO("") << "none";
+
+    // a log goes on to the sinks there were when it was made
+    EXPECT_EQ(messages,
+              vector<string>(
+                  {"add", "log", "added log", "reset", "added reset"}));
+    R::reset();
+}
+
+// -------------------------------------------------------------------
+// these log from several threads and confined sinks run on a worker
+// thread, which R_SINGLE_THREADED rules out
+
+#if !R_SINGLE_THREADED
+
+// -------------------------------------------------------------------
+
+struct PolicyTest : Test {
+    PolicyTest() { R::reset(R::Level::Info); }
+    virtual ~PolicyTest() override { R::reset(); }
+    /**
+     * @brief Logs from a few threads at once
+     */
+    void logFromThreads(int count) {
+        vector<thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([count] {
+                for (int j = 0; j < count; ++j) {
+                    R_INFO("policy") << j;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+};
+
+// -------------------------------------------------------------------
+
+TEST_F(PolicyTest, serialized) {
+    int inside = 0;
+    int most = 0;
+    int count = 0;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        most = max(most, ++inside);
+        ++count;
+        this_thread::yield();
+        --inside;
+    });
+    logFromThreads(1000);
+    EXPECT_EQ(count, 4000);
+    EXPECT_EQ(most, 1);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PolicyTest, threadSafe) {
+    atomic<int> count(0);
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { ++count; },
+               R::SinkPolicy::ThreadSafe);
+    logFromThreads(1000);
+    EXPECT_EQ(count, 4000);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PolicyTest, confined) {
+    set<thread::id> threads;
+    vector<string> messages;
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        threads.insert(this_thread::get_id());
+        messages.push_back(m.tag + " " + s);
+        if (s == "nested") {
+            R_INFO("inner") << "from sink";
+        }
+    }, R::SinkPolicy::Confined);
+
+    R_INFO("outer") << "nested";
+    logFromThreads(1000);
+    R::flush();
+    ASSERT_EQ(messages.size(), 4002u);
+    EXPECT_EQ(messages[0], "outer nested");
+    EXPECT_EQ(messages[1], "inner from sink");
+    ASSERT_EQ(threads.size(), 1u);
+    EXPECT_NE(*threads.begin(), this_thread::get_id());
+
+    // queued logs are passed before reset returns
+    R_INFO("last") << "log";
+    R::reset();
+    EXPECT_EQ(messages.back(), "last log");
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PolicyTest, confinedStopped) {
+    auto alive = make_shared<int>(0);
+    R::addSink(R_SINK_W_CAPTURE(m, s, alive) {}, R::SinkPolicy::Confined);
+    R::addSink(R_SINK(m, s) {
+        if (s == "reset") {
+            R::reset(R::Level::Info);
+        }
+    });
+    // reset by a Sink, while logs might still be reading the Confined one
+    R_INFO("") << "reset";
+    EXPECT_GT(alive.use_count(), 1);
+    // its worker is stopped once the Sinks holding it are freed
+    R::addSink(R_SINK(m, s){});
+    EXPECT_EQ(alive.use_count(), 1);
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PolicyTest, confinedNested) {
+    mutex guard;
+    vector<string> messages;
+    const auto add = [&](const string& s) {
+        lock_guard<mutex> lock(guard);
+        messages.push_back(s);
+    };
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        add(s);
+        if (s == "add") {
+            R::addSink(R_SINK_W_CAPTURE(m, s, &) { add("added " + s); });
+        } else if (s == "reset") {
+            // frees this very Sink, from its own worker
+            R::reset(R::Level::Info);
+        }
+    }, R::SinkPolicy::Confined);
+    R_INFO("") << "add";
+    R::flush();
+    R_INFO("") << "log";
+    R_INFO("") << "reset";
+    // waits for the worker, while it resets
+    R::flush();
+    R_INFO("") << "none";
+    R::flush();
+    {
+        lock_guard<mutex> lock(guard);
+        // the added Sink is called by logging threads, so in any order
+        sort(messages.begin(), messages.end());
+        EXPECT_EQ(messages,
+                  vector<string>(
+                      {"add", "added log", "added reset", "log", "reset"}));
+        messages.clear();
+    }
+
+    // and Sinks can be added again, freeing the reset ones
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { add(s); },
+               R::SinkPolicy::Confined);
+    R_INFO("") << "again";
+    R::flush();
+    lock_guard<mutex> lock(guard);
+    EXPECT_EQ(messages, vector<string>({"again"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST_F(PolicyTest, confinedFull) {
+    // more logs than the queue holds, while the Sink resets on the first
+    atomic<int> count(0);
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        if (count++ == 0) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+            R::reset(R::Level::Info);
+        }
+    }, R::SinkPolicy::Confined);
+    for (int i = 0; i < 2 * R_ASYNC_CAPACITY; ++i) {
+        R_INFO("") << i;
+    }
+    R::flush();
+    EXPECT_GT(count, 1);
+}
+
+// -------------------------------------------------------------------
+
+#endif
+
+// -------------------------------------------------------------------
+
+TEST(LockTest, spin) {
+    R::internal::SpinLock lock;
+    EXPECT_TRUE(lock.try_lock());
+    EXPECT_FALSE(lock.try_lock());
+    lock.unlock();
+
+    long count = 0;
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 10000; ++j) {
+                lock_guard<R::internal::SpinLock> guard(lock);
+                ++count;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(count, 40000);
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
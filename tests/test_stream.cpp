@@ -0,0 +1,164 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <limits>
+#include <vector>
+
+// -------------------------------------------------------------------
+// << operators declared at global scope, for types of other namespaces
+
+namespace shapes {
+struct Shape {
+    std::string name;
+};
+}  // namespace shapes
+
+using std::ostream;
+
+R_USERTYPE_DEF(shapes::Shape, s, "[" << s.name << "]");
+
+std::ostream& operator<<(std::ostream& os, const std::vector<int>& v) {
+    for (const int i : v) {
+        os << '<' << i << '>';
+    }
+    return os;
+}
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+struct Point {
+    int x;
+    int y;
+};
+
+ostream& operator<<(ostream& os, const Point& p) {
+    return os << '(' << p.x << ',' << p.y << ')';
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, integers) {
+    R::internal::LogStream stream;
+    ostringstream expected;
+    stream << 0 << ' ' << numeric_limits<int>::min() << ' '
+           << numeric_limits<long long>::min() << ' '
+           << numeric_limits<unsigned long long>::max() << ' ' << short(-3)
+           << ' ' << (unsigned short)65535 << ' ' << 99 << ' ' << 100 << ' '
+           << -7L << ' ' << 42u;
+    expected << 0 << ' ' << numeric_limits<int>::min() << ' '
+             << numeric_limits<long long>::min() << ' '
+             << numeric_limits<unsigned long long>::max() << ' ' << short(-3)
+             << ' ' << (unsigned short)65535 << ' ' << 99 << ' ' << 100
+             << ' ' << -7L << ' ' << 42u;
+    EXPECT_EQ(stream.str(), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, floats) {
+    R::internal::LogStream stream;
+    ostringstream expected;
+    const double values[] = {4.5,      1e20,      0.1,     -0.0,
+                             123456.0, 1234567.0, -42.0,   1e-7,
+                             3.0,      2.5e-300,  999999.0};
+    for (const double v : values) {
+        stream << v << ' ';
+        expected << v << ' ';
+    }
+    stream << 0.1f << ' ' << 1.5L << ' '
+           << numeric_limits<double>::infinity();
+    expected << 0.1f << ' ' << 1.5L << ' '
+             << numeric_limits<double>::infinity();
+    EXPECT_EQ(stream.str(), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, others) {
+    R::internal::LogStream stream;
+    ostringstream expected;
+    int i = 0;
+    const char* null = nullptr;
+    const string text = "text";
+    stream << true << false << 'c' << (signed char)'s' << (unsigned char)'u'
+           << "X" << null << text << &i << static_cast<void*>(nullptr)
+           << endl;
+    expected << true << false << 'c' << (signed char)'s'
+             << (unsigned char)'u' << "X" << text << &i
+             << static_cast<void*>(nullptr) << endl;
+    stream << R::StringRef("ref");
+    expected << "ref";
+    EXPECT_EQ(stream.str(), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, manipulators) {
+    R::internal::LogStream stream;
+    ostringstream expected;
+    stream << hex << 255 << dec << ' ' << boolalpha << false << noboolalpha
+           << ' ' << setw(6) << setfill('.') << 42 << ' '
+           << setprecision(3) << 3.14159 << ' ' << Point{1, 2};
+    expected << hex << 255 << dec << ' ' << boolalpha << false
+             << noboolalpha << ' ' << setw(6) << setfill('.') << 42 << ' '
+             << setprecision(3) << 3.14159 << ' ' << Point{1, 2};
+    EXPECT_EQ(stream.str(), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, globalOperators) {
+    R::internal::LogStream stream;
+    stream << shapes::Shape{"circle"} << ' ' << vector<int>({1, 2});
+    EXPECT_EQ(stream.str(), "[circle] <1><2>");
+
+    vector<string> messages;
+    R::reset(R::Level::Info);
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) { messages.push_back(s); });
+    R_INFO("") << shapes::Shape{"square"} << vector<int>({3});
+    R::reset();
+    EXPECT_EQ(messages, vector<string>({"[square]<3>"}));
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, spill) {
+    R::internal::LogStream stream;
+    ostringstream expected;
+    const string text(100, 'x');
+    for (int i = 0; i < 10; ++i) {
+        stream << text << i << Point{i, i};
+        expected << text << i << Point{i, i};
+    }
+    EXPECT_EQ(stream.str(), expected.str());
+    stream << "more";
+    expected << "more";
+    EXPECT_EQ(stream.str(), expected.str());
+}
+
+// -------------------------------------------------------------------
+
+TEST(StreamTest, reset) {
+    R::internal::LogStream stream;
+    stream << hex << setw(4) << 255 << string(300, 'x');
+    stream.reset();
+    stream << 255 << ' ' << 1.5;
+    EXPECT_EQ(stream.str(), "255 1.5");
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
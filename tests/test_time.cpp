@@ -0,0 +1,166 @@
+#include "rlog.hpp"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// -------------------------------------------------------------------
+
+namespace {
+
+// -------------------------------------------------------------------
+
+using namespace std;
+using namespace testing;
+
+// -------------------------------------------------------------------
+
+/**
+ * @brief Formats time like rlog did before caching, for reference
+ */
+string reference(long long time) {
+    auto now = chrono::system_clock::time_point(
+        chrono::duration_cast<chrono::system_clock::duration>(
+            chrono::nanoseconds(time)));
+    auto time_tt = chrono::system_clock::to_time_t(now);
+    tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &time_tt);
+#else
+    localtime_r(&time_tt, &tm);
+#endif
+    ostringstream os;
+    os << put_time(&tm, "%H-%M-%S");
+    return os.str();
+}
+
+long long now() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename F>
+long long measure(F f) {
+    const auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now() - start)
+        .count();
+}
+
+// -------------------------------------------------------------------
+
+TEST(TimeTest, timestamp) {
+    const long long second = 1000000000;
+    const long long start = now();
+    // within a second, across seconds, minutes and hours, and back
+    const long long times[] = {start,
+                               start + 1,
+                               start + second / 2,
+                               start + second,
+                               start + 61 * second,
+                               start + 3601 * second,
+                               start,
+                               0,
+                               second - 1};
+    for (const long long time : times) {
+        EXPECT_EQ(R::internal::timestamp(time), reference(time)) << time;
+    }
+}
+
+// -------------------------------------------------------------------
+
+TEST(TimeTest, lazy) {
+    R::reset(R::Level::Info);
+    vector<bool> stamped;
+    const R::Formatter plain = R::makeSmartFormatter("#message");
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        plain(m, s);
+        stamped.push_back(!m.stamp.empty());
+        stamped.push_back(m.time != R::Metadata::unconverted);
+    });
+    R::addSink(R_SINK_W_CAPTURE(m, s, &) {
+        const string& timestamp = m.timestamp();
+        EXPECT_EQ(timestamp, reference(m.nanoseconds()));
+        // memoized
+        EXPECT_EQ(&m.timestamp(), &timestamp);
+        stamped.push_back(!m.stamp.empty());
+    });
+    R_INFO("") << "time";
+    R::reset();
+
+    // neither converted nor formatted until a sink asks for it
+    EXPECT_EQ(stamped, vector<bool>({false, false, true}));
+
+    // formatted again if time is changed
+    R::Metadata metadata(R::Level::Info, __FILE__, __LINE__);
+    metadata.time = 0;
+    EXPECT_EQ(metadata.timestamp(), reference(0));
+    metadata.time = 3600LL * 1000000000;
+    EXPECT_EQ(metadata.timestamp(), reference(metadata.time));
+}
+
+// -------------------------------------------------------------------
+
+#if R_INTERNAL_X86
+
+TEST(TimeTest, tsc) {
+    using Clock = R::internal::TscClock<>;
+    long long previous = 0;
+    long long drift = 0;
+    // long enough for calibration to be refreshed
+    const auto end = chrono::steady_clock::now() + chrono::milliseconds(1500);
+    while (chrono::steady_clock::now() < end) {
+        // never goes back
+        for (int i = 0; i < 1000; ++i) {
+            const long long time = Clock::time(Clock::ticks());
+            ASSERT_GE(time, previous);
+            previous = time;
+        }
+        // stays close to system_clock
+        const long long before = R::internal::SystemClock::ticks();
+        const long long time = Clock::time(Clock::ticks());
+        const long long after = R::internal::SystemClock::ticks();
+        drift = max(drift, max(before - time, time - after));
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+    cout << "tsc clock " << (Clock::invariant() ? "" : "not ")
+         << "available, most drift from system_clock: " << drift << "ns"
+         << endl;
+    // the first calibration is measured over 2ms, so its rate may be off by
+    // up to 500 ppm, i.e. 0.5ms until refreshed, with some leeway for
+    // system_clock being slewed meanwhile
+    EXPECT_LT(drift, 2000000);
+}
+
+#endif
+
+// -------------------------------------------------------------------
+
+TEST(TimeTest, speed) {
+    const int count = 100000;
+    const long long start = now();
+    size_t total = 0;
+    // logs at 100ns intervals, i.e. mostly within the same second
+    const long long cached = measure([&] {
+        for (int i = 0; i < count; ++i) {
+            total += R::internal::timestamp(start + i * 100).size();
+        }
+    });
+    const long long uncached = measure([&] {
+        for (int i = 0; i < count; ++i) {
+            total += reference(start + i * 100).size();
+        }
+    });
+    // reported only, as timings on a shared host are not reliable
+    cout << "ns per timestamp, cached: " << cached / count
+         << ", localtime & put_time: " << uncached / count << endl;
+
+    EXPECT_EQ(total, 2u * 8u * count);
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
@@ -0,0 +1,86 @@
+#include "rlog.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// -------------------------------------------------------------------
+// rlog-decode: turns files written by R::BinarySink back into text
+//
+// usage: rlog-decode [--json | --format <format>] <file>
+//   default: one line per log, formatted by R::makeSmartFormatter
+//   --json: a json array, as written by R::JsonSink
+//   --format: one line per log, using a custom SmartFormatter format
+
+namespace {
+
+// -------------------------------------------------------------------
+
+int usage() {
+    std::cerr << "usage: rlog-decode [--json | --format <format>] <file>"
+              << std::endl;
+    return 2;
+}
+
+// -------------------------------------------------------------------
+
+}  // namespace
+
+// -------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    bool json = false;
+    std::string format = R::defaultSmartFormat;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!path) {
+        return usage();
+    }
+
+    std::ifstream is(path, std::ios::binary);
+    R::BinaryDecoder decoder(is);
+    if (!decoder.valid) {
+        std::cerr << "rlog-decode: " << path << " is not an rlog binary file"
+                  << std::endl;
+        return 1;
+    }
+
+    const R::Formatter formatter =
+        json ? R::JsonFormatter : R::makeSmartFormatter(format);
+    bool first = true;
+    if (json) {
+        std::cout << "[";
+    }
+    while (decoder.next()) {
+        if (json) {
+            std::cout << (first ? "" : ",");
+        }
+        std::cout << formatter(decoder.metadata, decoder.message);
+        if (!json) {
+            std::cout << "\n";
+        }
+        first = false;
+    }
+    if (json) {
+        std::cout << "\n]" << std::endl;
+    }
+    if (!decoder.valid) {
+        std::cerr << "rlog-decode: " << path << " is truncated or malformed"
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------